@@ -0,0 +1,28 @@
+#include "arena.hpp"
+
+void *CycleArena::CountingResource::do_allocate(size_t n, size_t align) {
+    ++allocs;
+    bytes += n;
+    return std::pmr::new_delete_resource()->allocate(n, align);
+}
+
+void CycleArena::CountingResource::do_deallocate(void *p, size_t n, size_t align) {
+    std::pmr::new_delete_resource()->deallocate(p, n, align);
+}
+
+CycleArena::CycleArena(size_t initial_bytes)
+: buffer_(initial_bytes),
+  pool_(new std::pmr::monotonic_buffer_resource(buffer_.data(), buffer_.size(), &upstream_)) {}
+
+void CycleArena::reset() {
+    pool_->release();
+    if (upstream_.allocs > 0) {
+        // The cycle did not fit, size the buffer for the next one
+        size_t want = buffer_.size() + upstream_.bytes;
+        pool_.reset();
+        buffer_.assign(want + want / 4, 0);
+        pool_.reset(new std::pmr::monotonic_buffer_resource(buffer_.data(), buffer_.size(), &upstream_));
+    }
+    upstream_.allocs = 0;
+    upstream_.bytes = 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <memory_resource>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+// Monotonic per-cycle arena. Allocations bump a pointer inside one buffer and
+// are released in bulk by reset(). When a cycle overflows the buffer the extra
+// memory comes from the heap and the buffer is grown on the next reset, so
+// steady-state cycles do not touch malloc at all
+class CycleArena {
+public:
+    explicit CycleArena(size_t initial_bytes = 64 * 1024);
+    std::pmr::memory_resource *resource() { return pool_.get(); }
+    // Frees everything allocated since the last reset
+    void reset();
+    size_t capacity() const { return buffer_.size(); }
+    // Heap allocations that overflowed the buffer since the last reset
+    size_t overflow_allocs() const { return upstream_.allocs; }
+
+private:
+    // Counts what the pool has to take from the heap
+    struct CountingResource : std::pmr::memory_resource {
+        size_t allocs = 0;
+        size_t bytes = 0;
+        void *do_allocate(size_t n, size_t align) override;
+        void do_deallocate(void *p, size_t n, size_t align) override;
+        bool do_is_equal(const std::pmr::memory_resource &o) const noexcept override { return this == &o; }
+    };
+    std::vector<char> buffer_;
+    CountingResource upstream_;
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> pool_;
+};
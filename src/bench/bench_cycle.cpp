@@ -0,0 +1,105 @@
+// Allocation benchmark of the poll-to-export path without network:
+// renders and flushes targets x series datapoints per cycle and reports
+// heap allocations per cycle. Exits with 1 when --max-allocs is exceeded
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <atomic>
+#include <new>
+#include <getopt.h>
+#include "../otel.hpp"
+
+#if defined(__GNUC__) && !defined(__clang__)
+// The counting operator new below pairs with free(), GCC cannot see that
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static std::atomic<size_t> g_allocs{0};
+static std::atomic<size_t> g_bytes{0};
+
+void *operator new(size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_bytes.fetch_add(n, std::memory_order_relaxed);
+    if (void *p = malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+int main(int argc, char **argv) {
+    int targets = 10;
+    int series = 100;
+    int cycles = 100;
+    long max_allocs = -1;
+    static const struct option long_opts[] = {
+        {"targets", required_argument, nullptr, 't'},
+        {"series", required_argument, nullptr, 's'},
+        {"cycles", required_argument, nullptr, 'c'},
+        {"max-allocs", required_argument, nullptr, 'a'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "t:s:c:a:", long_opts, nullptr)) != -1) {
+        switch (opt) {
+            case 't': targets = atoi(optarg); break;
+            case 's': series = atoi(optarg); break;
+            case 'c': cycles = atoi(optarg); break;
+            case 'a': max_allocs = atol(optarg); break;
+            default:
+                fprintf(stderr, "Usage: bench_cycle [--targets n] [--series n] [--cycles n] [--max-allocs n]\n");
+                return 2;
+        }
+    }
+
+    // Half scalars, half rows of one mapped table column
+    std::map<std::string, OIDInfo> rules;
+    rules["1.3.6.1.2.1.2.2.1.10.*"] = OIDInfo{"snmp.ifInOctets", "By", "gauge"};
+    OIDMapping mapping(rules);
+    SeriesRegistry reg;
+    std::vector<std::vector<SeriesId>> ids(targets);
+    for (int t = 0; t < targets; ++t) {
+        uint32_t tid = reg.intern_target("10.0." + std::to_string(t / 256) + "." + std::to_string(t % 256));
+        for (int s = 0; s < series; ++s) {
+            std::string oid = (s % 2) ? "1.3.6.1.2.1.2.2.1.10." + std::to_string(s)
+                                      : "1.3.6.1.4.1.99." + std::to_string(s) + ".0";
+            ids[t].push_back(reg.intern(tid, oid, mapping));
+        }
+    }
+    SampleBatch batch;
+    batch.reserve(reg.size());
+
+    BatchLimits limits;
+    limits.max_points = (size_t)targets * series + 1;
+    limits.max_bytes = SIZE_MAX;
+    OTELExporter exporter(std::vector<std::string>(), limits);
+
+    auto cycle = [&](int c) {
+        batch.clear();
+        uint64_t ts = now_unix_nano();
+        for (int t = 0; t < targets; ++t)
+            for (SeriesId id : ids[t]) batch.append(id, ts, SampleType::Gauge, (int64_t)(id * 7919 + c));
+        exporter.export_batch(batch, reg);
+        exporter.flush();
+    };
+    // Warm up templates and the arena size
+    cycle(0);
+    cycle(1);
+
+    size_t a0 = g_allocs.load(), b0 = g_bytes.load();
+    auto t0 = std::chrono::steady_clock::now();
+    for (int c = 0; c < cycles; ++c) cycle(c + 2);
+    auto t1 = std::chrono::steady_clock::now();
+    double allocs = double(g_allocs.load() - a0) / cycles;
+    double bytes = double(g_bytes.load() - b0) / cycles;
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / cycles;
+    double points = double(targets) * series;
+
+    printf("targets=%d series=%d datapoints/cycle=%.0f\n", targets, series, points);
+    printf("  %.0f ns/cycle  %.1f ns/datapoint\n", ns, ns / points);
+    printf("  %.1f allocs/cycle  %.0f bytes/cycle\n", allocs, bytes);
+    if (max_allocs >= 0 && allocs > max_allocs) {
+        fprintf(stderr, "[ERROR] %.1f allocations per cycle exceed the limit of %ld\n", allocs, max_allocs);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,248 @@
+// Microbenchmarks of the conversion and serialization hot paths at 10, 1k
+// and 100k items per operation: OID to string, OID list and mapping file
+// loading, varbind decoding and OTLP body construction. Reports ns/op,
+// allocations/op and bytes/op. --save writes a baseline, --compare checks
+// against one and exits with 1 on a regression beyond --tolerance percent
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <atomic>
+#include <new>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <getopt.h>
+#include <unistd.h>
+#include "../otel.hpp"
+#include "../snmp.hpp"
+
+#if defined(__GNUC__) && !defined(__clang__)
+// The counting operator new below pairs with free(), GCC cannot see that
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static std::atomic<size_t> g_allocs{0};
+static std::atomic<size_t> g_bytes{0};
+
+void *operator new(size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_bytes.fetch_add(n, std::memory_order_relaxed);
+    if (void *p = malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+namespace {
+
+struct Result {
+    double ns;
+    double allocs;
+    double bytes;
+};
+
+// Repeats op until min_ms passed (at least twice, the first run is a warm up)
+Result measure(const std::function<void()> &op, int min_ms) {
+    op();
+    size_t a0 = g_allocs.load(), b0 = g_bytes.load();
+    auto t0 = std::chrono::steady_clock::now();
+    auto until = t0 + std::chrono::milliseconds(min_ms);
+    long ops = 0;
+    do {
+        op();
+        ++ops;
+    } while (std::chrono::steady_clock::now() < until);
+    auto t1 = std::chrono::steady_clock::now();
+    return Result{std::chrono::duration<double, std::nano>(t1 - t0).count() / ops,
+                  double(g_allocs.load() - a0) / ops, double(g_bytes.load() - b0) / ops};
+}
+
+// Varbinds of n ifInOctets rows holding Counter32 values
+struct Varbinds {
+    std::vector<netsnmp_variable_list> vars;
+    std::vector<std::vector<oid>> names;
+    std::vector<long> values;
+
+    explicit Varbinds(size_t n) : vars(n), names(n), values(n) {
+        for (size_t i = 0; i < n; ++i) {
+            names[i] = {1, 3, 6, 1, 2, 1, 2, 2, 1, 10, (oid)(i + 1)};
+            values[i] = (long)(i * 7919);
+            netsnmp_variable_list &v = vars[i];
+            v.next_variable = i + 1 < n ? &vars[i + 1] : nullptr;
+            v.name = names[i].data();
+            v.name_length = names[i].size();
+            v.type = ASN_COUNTER;
+            v.val.integer = &values[i];
+            v.val_len = sizeof(long);
+        }
+    }
+};
+
+std::string temp_path(const char *name) {
+    return std::string("/tmp/bench_micro_") + std::to_string(getpid()) + "_" + name;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::string save_file;
+    std::string compare_file;
+    double tolerance = 10;
+    int min_ms = 200;
+    static const struct option long_opts[] = {
+        {"save", required_argument, nullptr, 's'},
+        {"compare", required_argument, nullptr, 'c'},
+        {"tolerance", required_argument, nullptr, 't'},
+        {"min-ms", required_argument, nullptr, 'm'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "s:c:t:m:", long_opts, nullptr)) != -1) {
+        switch (opt) {
+            case 's': save_file = optarg; break;
+            case 'c': compare_file = optarg; break;
+            case 't': tolerance = atof(optarg); break;
+            case 'm': min_ms = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: bench_micro [--save file] [--compare file [--tolerance pct]] [--min-ms ms]\n");
+                return 2;
+        }
+    }
+
+    std::map<std::string, Result> baseline;
+    if (!compare_file.empty()) {
+        FILE *f = fopen(compare_file.c_str(), "r");
+        if (!f) {
+            fprintf(stderr, "[ERROR] Cannot read baseline %s\n", compare_file.c_str());
+            return 2;
+        }
+        char name[128];
+        Result r;
+        while (fscanf(f, "%127s %lf %lf %lf", name, &r.ns, &r.allocs, &r.bytes) == 4) baseline[name] = r;
+        fclose(f);
+    }
+
+    std::map<std::string, Result> results;
+    std::vector<std::string> order;
+    auto run = [&](const std::string &name, size_t n, const std::function<void()> &op) {
+        std::string key = name + "/" + std::to_string(n);
+        Result r = measure(op, min_ms);
+        results[key] = r;
+        order.push_back(key);
+        printf("%-24s %14.0f ns/op %10.1f ns/item %10.1f allocs/op %12.0f bytes/op", key.c_str(),
+               r.ns, r.ns / n, r.allocs, r.bytes);
+        auto b = baseline.find(key);
+        if (b != baseline.end()) printf("  %+6.1f%% time", b->second.ns > 0 ? (r.ns / b->second.ns - 1) * 100 : 0.0);
+        printf("\n");
+    };
+
+    for (size_t n : {(size_t)10, (size_t)1000, (size_t)100000}) {
+        Varbinds vb(n);
+        run("get_oid_to_string", n, [&]() {
+            size_t len = 0;
+            for (auto &v : vb.vars) len += get_oid_to_string(&v).size();
+            if (len == 0) abort();
+        });
+        run("decode_value", n, [&]() {
+            int64_t sum = 0;
+            SampleType type;
+            int64_t value;
+            for (const netsnmp_variable_list *v = &vb.vars[0]; v; v = v->next_variable)
+                if (decode_value(v, type, value)) sum += value;
+            if (sum < 0) abort();
+        });
+
+        // Startup cost per device, net-snmp itself is initialized once
+        run("snmp_client_new", n, [&]() {
+            std::vector<std::unique_ptr<SNMPClient>> clients(n);
+            for (auto &c : clients) c.reset(new SNMPClient("10.0.0.1", 161, "public", 1000, 2));
+        });
+
+        std::string oids_path = temp_path("oids.txt");
+        std::string map_path = temp_path("mapping.json");
+        {
+            std::ofstream oids(oids_path);
+            std::ofstream map(map_path);
+            map << "{\n";
+            for (size_t i = 0; i < n; ++i) {
+                oids << "1.3.6.1.4.1.99." << i << ".0\n";
+                map << (i ? ",\n" : "") << "\"1.3.6.1.4.1.99." << i << ".0\": {\"name\": \"bench.m" << i
+                    << "\", \"unit\": \"1\", \"type\": \"gauge\"}";
+            }
+            map << "\n}\n";
+        }
+        run("load_oids_file", n, [&]() {
+            if (load_oids_file(oids_path).size() != n) abort();
+        });
+        run("load_oids_info", n, [&]() {
+            if (load_oids_info(map_path).size() != n) abort();
+        });
+        unlink(oids_path.c_str());
+        unlink(map_path.c_str());
+
+        // n datapoints over targets of up to 100 series, half of them table rows
+        std::map<std::string, OIDInfo> rules;
+        rules["1.3.6.1.2.1.2.2.1.10.*"] = OIDInfo{"snmp.ifInOctets", "By", "gauge"};
+        OIDMapping mapping(rules);
+        SeriesRegistry reg;
+        size_t per_target = std::min<size_t>(n, 100);
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t t = reg.intern_target("10.0." + std::to_string(i / per_target / 256) + "." +
+                                           std::to_string(i / per_target % 256));
+            std::string oid = (i % 2) ? "1.3.6.1.2.1.2.2.1.10." + std::to_string(i % per_target)
+                                      : "1.3.6.1.4.1.99." + std::to_string(i % per_target) + ".0";
+            reg.intern(t, oid, mapping);
+        }
+        SampleBatch batch;
+        batch.reserve(n);
+        BatchLimits limits;
+        limits.max_points = n + 1;
+        limits.max_bytes = SIZE_MAX;
+        limits.max_request_bytes = SIZE_MAX;
+        OTELExporter exporter(std::vector<std::string>(), limits);
+        int64_t c = 0;
+        run("export_body", n, [&]() {
+            batch.clear();
+            uint64_t ts = now_unix_nano();
+            for (SeriesId id = 0; id < reg.size(); ++id) batch.append(id, ts, SampleType::Gauge, (int64_t)id * 7919 + c);
+            ++c;
+            exporter.export_batch(batch, reg);
+            exporter.flush();
+        });
+    }
+
+    if (!save_file.empty()) {
+        FILE *f = fopen(save_file.c_str(), "w");
+        if (!f) {
+            fprintf(stderr, "[ERROR] Cannot write baseline %s\n", save_file.c_str());
+            return 2;
+        }
+        for (const auto &key : order)
+            fprintf(f, "%s %.1f %.2f %.0f\n", key.c_str(), results[key].ns, results[key].allocs, results[key].bytes);
+        fclose(f);
+        printf("Baseline saved to %s\n", save_file.c_str());
+    }
+    if (!compare_file.empty()) {
+        // Time may drift by the tolerance, allocation counts are deterministic
+        int regressions = 0;
+        for (const auto &key : order) {
+            auto b = baseline.find(key);
+            if (b == baseline.end()) continue;
+            const Result &r = results[key];
+            if (r.ns > b->second.ns * (1 + tolerance / 100)) {
+                fprintf(stderr, "[ERROR] %s: %.0f ns/op, baseline %.0f ns/op\n", key.c_str(), r.ns, b->second.ns);
+                ++regressions;
+            }
+            if (r.allocs > b->second.allocs + 0.5) {
+                fprintf(stderr, "[ERROR] %s: %.1f allocs/op, baseline %.1f allocs/op\n", key.c_str(), r.allocs, b->second.allocs);
+                ++regressions;
+            }
+        }
+        if (regressions > 0) return 1;
+        printf("No regression against %s (tolerance %.0f%%)\n", compare_file.c_str(), tolerance);
+    }
+    return 0;
+}
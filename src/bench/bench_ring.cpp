@@ -0,0 +1,61 @@
+// Throughput of the pipeline rings: one producer/one consumer over SpscRing
+// and N producers/one consumer over MpscRing, reported as ns per item
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <getopt.h>
+#include "../ring.hpp"
+
+template <class Ring>
+static double run(Ring &ring, int producers, long items) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&ring, items] {
+            for (long i = 0; i < items; ++i)
+                while (!ring.push(i)) std::this_thread::yield();
+        });
+    }
+    long v, sum = 0;
+    for (long received = 0; received < items * producers;) {
+        if (!ring.pop(v)) { std::this_thread::yield(); continue; }
+        sum += v;
+        ++received;
+    }
+    for (auto &t : threads) t.join();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    if (sum != (items - 1) * items / 2 * producers) fprintf(stderr, "checksum mismatch\n");
+    return ns / (double)(items * producers);
+}
+
+int main(int argc, char **argv) {
+    long items = 2000000;
+    int producers = 4;
+    size_t capacity = 1024;
+    static const struct option long_opts[] = {
+        {"items", required_argument, nullptr, 'n'},
+        {"producers", required_argument, nullptr, 'p'},
+        {"capacity", required_argument, nullptr, 'c'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:p:c:", long_opts, nullptr)) != -1) {
+        switch (opt) {
+            case 'n': items = atol(optarg); break;
+            case 'p': producers = atoi(optarg); break;
+            case 'c': capacity = strtoul(optarg, nullptr, 10); break;
+            default:
+                fprintf(stderr, "Usage: bench_ring [--items n] [--producers n] [--capacity n]\n");
+                return 2;
+        }
+    }
+    SpscRing<long> spsc(capacity);
+    printf("spsc 1->1: %.1f ns/item\n", run(spsc, 1, items));
+    MpscRing<long> mpsc1(capacity);
+    printf("mpsc 1->1: %.1f ns/item\n", run(mpsc1, 1, items));
+    MpscRing<long> mpsc(capacity);
+    printf("mpsc %d->1: %.1f ns/item\n", producers, run(mpsc, producers, items / producers));
+    return 0;
+}
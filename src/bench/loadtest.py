@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+# End-to-end load test: snmp2otel polls N simulated agents (snmp_sim, one
+# loopback address each) for M OIDs and exports to a local otlp_sink for a
+# fixed duration. Writes a JSON report with polls/s, datapoints/s, CPU per
+# 1k datapoints, RSS, poll-to-export latency and missed poll deadlines.
+# Run through make loadtest, which builds the three binaries first
+import argparse
+import json
+import os
+import shutil
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def agent_address(k):
+    # Linux routes all of 127.0.0.0/8 to lo, no setup needed
+    return "127.1.%d.%d" % (k // 250, k % 250 + 1)
+
+
+def write_inputs(work, oids):
+    snmprec = os.path.join(work, "agent.snmprec")
+    oids_file = os.path.join(work, "oids.txt")
+    mapping_file = os.path.join(work, "mapping.json")
+    with open(snmprec, "w") as f:
+        f.write("1.3.6.1.2.1.1.3.0|67|0\n")
+        for i in range(1, oids + 1):
+            f.write("1.3.6.1.4.1.99999.1.%d|65|%d\n" % (i, i * 1000))
+    with open(oids_file, "w") as f:
+        for i in range(1, oids + 1):
+            f.write("1.3.6.1.4.1.99999.1.%d\n" % i)
+    with open(mapping_file, "w") as f:
+        json.dump({"1.3.6.1.4.1.99999.1.*": {"name": "loadtest.value", "unit": "1", "type": "gauge"}}, f)
+    return snmprec, oids_file, mapping_file
+
+
+def cpu_seconds(pid):
+    with open("/proc/%d/stat" % pid) as f:
+        fields = f.read().rsplit(")", 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / os.sysconf("SC_CLK_TCK")  # utime, stime
+
+
+def rss_mb(pid):
+    with open("/proc/%d/status" % pid) as f:
+        for line in f:
+            if line.startswith("VmRSS:"):
+                return int(line.split()[1]) / 1024.0
+    return 0.0
+
+
+def self_metrics(path):
+    # Counters as ints, summaries as {quantile: value}
+    with open(path) as f:
+        rm = json.load(f)
+    out = {}
+    for m in rm["scopeMetrics"][0]["metrics"]:
+        if "sum" in m:
+            out[m["name"]] = int(m["sum"]["dataPoints"][0]["asInt"])
+        elif "summary" in m:
+            out[m["name"]] = {q["quantile"]: q["value"] for q in m["summary"]["dataPoints"][0]["quantileValues"]}
+    return out
+
+
+def stop(proc, timeout=30):
+    if proc.poll() is None:
+        proc.send_signal(signal.SIGINT)
+    try:
+        proc.wait(timeout)
+    except subprocess.TimeoutExpired:
+        proc.kill()
+        proc.wait()
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--agents", type=int, default=100)
+    ap.add_argument("--oids", type=int, default=50)
+    ap.add_argument("--duration", type=int, default=60, help="seconds of polling")
+    ap.add_argument("--interval", type=int, default=1, help="poll interval in seconds")
+    ap.add_argument("--poll-threads", type=int, default=1)
+    ap.add_argument("--timeout-ms", type=int, default=1000)
+    ap.add_argument("--agent-port", type=int, default=16100)
+    ap.add_argument("--sink-port", type=int, default=14318)
+    ap.add_argument("--daemon", default="./snmp2otel")
+    ap.add_argument("--bin", default=".", help="directory with snmp_sim and otlp_sink")
+    ap.add_argument("--out", default="loadtest_report.json")
+    ap.add_argument("--keep", action="store_true", help="keep the work directory with inputs and logs")
+    args = ap.parse_args()
+    if not 0 < args.agents <= 60000:
+        sys.exit("[ERROR] --agents must be between 1 and 60000")
+
+    work = tempfile.mkdtemp(prefix="snmp2otel_loadtest_")
+    snmprec, oids_file, mapping_file = write_inputs(work, args.oids)
+    addresses = [agent_address(k) for k in range(args.agents)]
+    sink_json = os.path.join(work, "sink.json")
+    self_json = os.path.join(work, "self_metrics.json")
+    logs = {name: open(os.path.join(work, name + ".log"), "w") for name in ("sim", "sink", "snmp2otel")}
+
+    sim = subprocess.Popen([os.path.join(args.bin, "snmp_sim"), "--data", snmprec, "--ports", str(args.agent_port)]
+                           + [a for addr in addresses for a in ("--address", addr)],
+                           stdout=logs["sim"], stderr=subprocess.STDOUT)
+    sink = subprocess.Popen([os.path.join(args.bin, "otlp_sink"), "--port", str(args.sink_port),
+                             "--report", "0", "--json", sink_json],
+                            stdout=logs["sink"], stderr=subprocess.STDOUT)
+    time.sleep(0.5)
+    if sim.poll() is not None or sink.poll() is not None:
+        stop(sim)
+        stop(sink)
+        sys.exit("[ERROR] Simulator or sink did not start, see %s" % work)
+
+    daemon = subprocess.Popen([args.daemon, "-t", ",".join(addresses),
+                               "-p", str(args.agent_port), "-o", oids_file, "-m", mapping_file,
+                               "-e", "http://127.0.0.1:%d/v1/metrics" % args.sink_port,
+                               "-i", str(args.interval), "-r", "0", "-T", str(args.timeout_ms),
+                               "--poll-threads", str(args.poll_threads), "--reload-interval", "0",
+                               "--self-metrics-file", self_json],
+                              stdout=logs["snmp2otel"], stderr=subprocess.STDOUT)
+    start = time.monotonic()
+    rss_peak = 0.0
+    while time.monotonic() - start < args.duration and daemon.poll() is None:
+        time.sleep(min(1.0, max(0.0, args.duration - (time.monotonic() - start))))
+        if daemon.poll() is None:
+            rss_peak = max(rss_peak, rss_mb(daemon.pid))
+    if daemon.poll() is not None:
+        stop(sim)
+        stop(sink)
+        sys.exit("[ERROR] snmp2otel exited with %d, see %s" % (daemon.returncode, work))
+    elapsed = time.monotonic() - start
+    cpu = cpu_seconds(daemon.pid)
+    rss_end = rss_mb(daemon.pid)
+    stop(daemon)
+    stop(sink)
+    stop(sim)
+    for f in logs.values():
+        f.close()
+
+    sink_stats = json.load(open(sink_json))
+    own = self_metrics(self_json)
+    points = sink_stats["points"]
+    rtt = own.get("snmp2otel.snmp.rtt", {})
+    report = {
+        "config": {"agents": args.agents, "oids": args.oids, "duration_s": args.duration,
+                   "interval_s": args.interval, "poll_threads": args.poll_threads},
+        "elapsed_s": round(elapsed, 3),
+        "poll_cycles": own.get("snmp2otel.poll.cycles", 0),
+        "missed_deadlines": own.get("snmp2otel.poll.missed_deadlines", 0),
+        "polls_per_s": round(own.get("snmp2otel.snmp.requests", 0) / elapsed, 1),  # SNMP GET requests
+        "snmp_timeouts": own.get("snmp2otel.snmp.timeouts", 0),
+        "snmp_rtt_ms": {"p50": rtt.get(0.5, 0) / 1e6, "p99": rtt.get(0.99, 0) / 1e6},
+        "datapoints": points,
+        "datapoints_per_s": round(points / elapsed, 1),
+        "cpu_s": round(cpu, 3),
+        "cpu_ms_per_1k_datapoints": round(cpu * 1e6 / points, 3) if points else None,
+        "rss_peak_mb": round(rss_peak, 1),
+        "rss_end_mb": round(rss_end, 1),
+        "poll_to_export_latency_ms": sink_stats["latency_ms"],
+        "export": {"requests": sink_stats["requests"], "wire_bytes": sink_stats["wire_bytes"],
+                   "failures": own.get("snmp2otel.export.failures", 0),
+                   "rejected": sink_stats["rejected"], "bad_timestamps": sink_stats["bad_timestamps"],
+                   "reordered": sink_stats["reordered"]},
+    }
+    with open(args.out, "w") as f:
+        json.dump(report, f, indent=2)
+        f.write("\n")
+    print("[INFO] %d agents x %d OIDs for %.0f s: %.0f polls/s, %.0f datapoints/s, %s ms CPU per 1k datapoints, "
+          "RSS %.1f MB, latency p50 %.1f ms p99 %.1f ms, %d missed deadlines"
+          % (args.agents, args.oids, elapsed, report["polls_per_s"], report["datapoints_per_s"],
+             report["cpu_ms_per_1k_datapoints"], rss_peak, sink_stats["latency_ms"]["p50"],
+             sink_stats["latency_ms"]["p99"], report["missed_deadlines"]))
+    print("[INFO] Report written to %s" % args.out)
+    if args.keep:
+        print("[INFO] Inputs and logs kept in %s" % work)
+    else:
+        shutil.rmtree(work)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,366 @@
+// OTLP/HTTP metrics sink for end-to-end benchmarks. Accepts JSON and
+// protobuf export requests (optionally gzip), counts requests, bytes and
+// datapoints without building a document, checks datapoint timestamps and
+// request order per sender, and reports ingest throughput with histograms of
+// end-to-end latency (receive time minus datapoint time) and handler time.
+// Replaces OTELendpoint.py, which prints every request
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <getopt.h>
+#define CPPHTTPLIB_ZLIB_SUPPORT // inflates gzip request bodies
+#include <httplib.h>
+#include "../telemetry.hpp"
+
+namespace {
+
+std::atomic<bool> g_stop{false};
+void on_signal(int) { g_stop = true; }
+
+uint64_t unix_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+uint64_t mono_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Single threaded version of the daemon's telemetry histograms, same buckets
+class Histogram {
+public:
+    void add(uint64_t v) {
+        ++buckets_[telemetry::bucket_of(v)];
+        ++count_;
+        sum_ += v;
+        max_ = std::max(max_, v);
+    }
+    void merge(const Histogram &o) {
+        for (size_t i = 0; i < kBuckets; ++i) buckets_[i] += o.buckets_[i];
+        count_ += o.count_;
+        sum_ += o.sum_;
+        max_ = std::max(max_, o.max_);
+    }
+    uint64_t quantile(double q) const {
+        if (count_ == 0) return 0;
+        uint64_t rank = std::max<uint64_t>((uint64_t)(q * count_ + 0.999999), 1), seen = 0;
+        for (size_t b = 0; b < kBuckets; ++b)
+            if ((seen += buckets_[b]) >= rank) return std::min(telemetry::bucket_high(b), max_);
+        return max_;
+    }
+    uint64_t count() const { return count_; }
+    double mean() const { return count_ ? double(sum_) / count_ : 0; }
+    uint64_t max() const { return max_; }
+
+private:
+    static constexpr size_t kBuckets = telemetry::kBuckets;
+    uint64_t buckets_[kBuckets] = {};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+};
+
+// Timestamps of one request
+struct Scan {
+    uint64_t points = 0;
+    uint64_t min_ts = UINT64_MAX;
+    uint64_t max_ts = 0;
+    std::vector<uint64_t> ts;
+
+    void add(uint64_t t) {
+        ++points;
+        min_ts = std::min(min_ts, t);
+        max_ts = std::max(max_ts, t);
+        ts.push_back(t);
+    }
+};
+
+// Every datapoint of any metric type carries exactly one timeUnixNano
+bool scan_json(const std::string &body, Scan &scan) {
+    static const char key[] = "\"timeUnixNano\":";
+    const size_t key_len = sizeof(key) - 1;
+    for (size_t pos = body.find(key); pos != std::string::npos; pos = body.find(key, pos)) {
+        pos += key_len;
+        while (pos < body.size() && (body[pos] == ' ' || body[pos] == '"')) ++pos; // number or string form
+        uint64_t v = 0;
+        size_t start = pos;
+        while (pos < body.size() && body[pos] >= '0' && body[pos] <= '9') v = v * 10 + (uint64_t)(body[pos++] - '0');
+        if (pos == start) return false;
+        scan.add(v);
+    }
+    return body.size() >= 2 && body.front() == '{';
+}
+
+// ---- protobuf ----
+
+struct Pb {
+    const uint8_t *p;
+    const uint8_t *end;
+
+    bool varint(uint64_t &v) {
+        v = 0;
+        for (int shift = 0; shift < 64 && p < end; shift += 7) {
+            uint8_t b = *p++;
+            v |= (uint64_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+    // Next field: number, wire type and for length-delimited fields the payload
+    bool field(uint32_t &num, uint32_t &wire, Pb &sub, uint64_t &value) {
+        uint64_t key;
+        if (!varint(key)) return false;
+        num = (uint32_t)(key >> 3);
+        wire = (uint32_t)(key & 7);
+        switch (wire) {
+            case 0: return varint(value);
+            case 1:
+                if (end - p < 8) return false;
+                memcpy(&value, p, 8); // little endian hosts
+                p += 8;
+                return true;
+            case 2: {
+                uint64_t len;
+                if (!varint(len) || (uint64_t)(end - p) < len) return false;
+                sub = Pb{p, p + len};
+                p += len;
+                return true;
+            }
+            case 5:
+                if (end - p < 4) return false;
+                p += 4;
+                return true;
+            default: return false;
+        }
+    }
+    bool done() const { return p >= end; }
+};
+
+// Datapoints (field 3 fixed64 time_unix_nano) inside one data message
+bool pb_points(Pb data, Scan &scan) {
+    uint32_t num, wire;
+    Pb sub{nullptr, nullptr};
+    uint64_t value;
+    while (!data.done()) {
+        if (!data.field(num, wire, sub, value)) return false;
+        if (num != 1 || wire != 2) continue; // data_points
+        while (!sub.done()) {
+            uint32_t n, w;
+            Pb s{nullptr, nullptr};
+            uint64_t v;
+            if (!sub.field(n, w, s, v)) return false;
+            if (n == 3 && w == 1) scan.add(v);
+        }
+    }
+    return true;
+}
+
+// ExportMetricsServiceRequest > ResourceMetrics(1) > ScopeMetrics(2) > Metric(2) >
+// gauge(5) | sum(7) | histogram(9) | exponential_histogram(10) | summary(11)
+bool scan_protobuf(const std::string &body, Scan &scan) {
+    Pb req{(const uint8_t *)body.data(), (const uint8_t *)body.data() + body.size()};
+    uint32_t num, wire;
+    Pb rm{nullptr, nullptr};
+    uint64_t value;
+    while (!req.done()) {
+        if (!req.field(num, wire, rm, value)) return false;
+        if (num != 1 || wire != 2) continue;
+        while (!rm.done()) {
+            Pb sm{nullptr, nullptr};
+            if (!rm.field(num, wire, sm, value)) return false;
+            if (num != 2 || wire != 2) continue;
+            while (!sm.done()) {
+                Pb metric{nullptr, nullptr};
+                if (!sm.field(num, wire, metric, value)) return false;
+                if (num != 2 || wire != 2) continue;
+                while (!metric.done()) {
+                    Pb data{nullptr, nullptr};
+                    if (!metric.field(num, wire, data, value)) return false;
+                    if (wire == 2 && (num == 5 || num == 7 || num == 9 || num == 10 || num == 11) && !pb_points(data, scan))
+                        return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+struct Stats {
+    uint64_t requests = 0;
+    uint64_t wire_bytes = 0;
+    uint64_t body_bytes = 0;
+    uint64_t points = 0;
+    uint64_t rejected = 0;    // undecodable bodies
+    uint64_t bad_ts = 0;      // zero or in the future
+    uint64_t reordered = 0;   // request entirely older than the sender's previous one
+    Histogram latency;        // receive time minus datapoint time
+    Histogram handler;        // scan time per request
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::string host = "127.0.0.1";
+    int port = 4318;
+    int threads = (int)std::max(2u, std::thread::hardware_concurrency());
+    int report_s = 5;
+    int duration_s = 0;
+    std::string json_file;
+    int64_t future_ms = 60000;
+    static const struct option long_opts[] = {
+        {"host", required_argument, nullptr, 'H'},
+        {"port", required_argument, nullptr, 'p'},
+        {"threads", required_argument, nullptr, 't'},
+        {"report", required_argument, nullptr, 'r'},
+        {"duration", required_argument, nullptr, 'd'},
+        {"json", required_argument, nullptr, 'j'},
+        {"max-future-ms", required_argument, nullptr, 'f'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "H:p:t:r:d:j:f:", long_opts, nullptr)) != -1) {
+        switch (opt) {
+            case 'H': host = optarg; break;
+            case 'p': port = atoi(optarg); break;
+            case 't': threads = std::max(1, atoi(optarg)); break;
+            case 'r': report_s = atoi(optarg); break;
+            case 'd': duration_s = atoi(optarg); break;
+            case 'j': json_file = optarg; break;
+            case 'f': future_ms = atoll(optarg); break;
+            default:
+                fprintf(stderr, "Usage: otlp_sink [--host h] [--port p] [--threads n] [--report s]\n"
+                                "       [--duration s] [--json file] [--max-future-ms ms]\n");
+                return 2;
+        }
+    }
+
+    std::mutex mutex;
+    Stats total, window;
+    std::map<std::string, uint64_t> last_min_ts; // oldest datapoint of the previous request per address:port
+
+    httplib::Server server;
+    server.new_task_queue = [threads] { return new httplib::ThreadPool((size_t)threads); };
+    server.set_payload_max_length(256u << 20);
+    server.Post(R"(/v1/metrics/?)", [&](const httplib::Request &req, httplib::Response &res) {
+        uint64_t received = unix_ns();
+        // httplib has already inflated a gzip body, the header still has the size on the wire
+        uint64_t t0 = mono_ns();
+        const std::string &body = req.body;
+        size_t wire = req.has_header("Content-Length")
+                      ? strtoull(req.get_header_value("Content-Length").c_str(), nullptr, 10) : body.size();
+        bool protobuf = req.get_header_value("Content-Type").find("protobuf") != std::string::npos;
+        Scan scan;
+        bool ok = protobuf ? scan_protobuf(body, scan) : scan_json(body, scan);
+
+        Histogram latency;
+        uint64_t bad = 0;
+        uint64_t limit = received + (uint64_t)future_ms * 1000000ull;
+        for (uint64_t ts : scan.ts) {
+            if (ts == 0 || ts > limit) ++bad;
+            else latency.add(received > ts ? received - ts : 0);
+        }
+        uint64_t handler_ns = mono_ns() - t0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (Stats *s : {&total, &window}) {
+                ++s->requests;
+                s->wire_bytes += wire;
+                s->body_bytes += body.size();
+                if (!ok) {
+                    ++s->rejected;
+                    continue;
+                }
+                s->points += scan.points;
+                s->bad_ts += bad;
+                s->latency.merge(latency);
+                s->handler.add(handler_ns);
+            }
+            if (ok && scan.points > 0) {
+                // Exporters on one host each keep their own connection
+                uint64_t &prev = last_min_ts[req.remote_addr + ":" + std::to_string(req.remote_port)];
+                if (scan.max_ts < prev) {
+                    ++total.reordered;
+                    ++window.reordered;
+                }
+                prev = scan.min_ts;
+            }
+        }
+        if (!ok) {
+            res.status = 400;
+            return;
+        }
+        if (protobuf) res.set_content("", "application/x-protobuf");
+        else res.set_content("{}", "application/json");
+    });
+
+    if (!server.bind_to_port(host, port)) {
+        fprintf(stderr, "[ERROR] Cannot listen on %s:%d\n", host.c_str(), port);
+        return 1;
+    }
+    std::thread listener([&]() { server.listen_after_bind(); });
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    printf("[INFO] OTLP sink on http://%s:%d/v1/metrics, %d threads\n", host.c_str(), port, threads);
+    fflush(stdout);
+
+    auto start = std::chrono::steady_clock::now();
+    auto last = start;
+    while (!g_stop) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto now = std::chrono::steady_clock::now();
+        if (duration_s > 0 && now - start >= std::chrono::seconds(duration_s)) break;
+        if (report_s <= 0 || now - last < std::chrono::seconds(report_s)) continue;
+        double secs = std::chrono::duration<double>(now - last).count();
+        last = now;
+        std::lock_guard<std::mutex> lock(mutex);
+        printf("[INFO] %.0f req/s %.0f points/s %.2f MB/s wire %.2f MB/s body | latency ms p50 %.1f p99 %.1f max %.1f"
+               " | handler us p50 %.0f p99 %.0f | rejected %llu bad_ts %llu reordered %llu\n",
+               window.requests / secs, window.points / secs, window.wire_bytes / secs / 1e6,
+               window.body_bytes / secs / 1e6, window.latency.quantile(0.5) / 1e6,
+               window.latency.quantile(0.99) / 1e6, window.latency.max() / 1e6,
+               window.handler.quantile(0.5) / 1e3, window.handler.quantile(0.99) / 1e3,
+               (unsigned long long)window.rejected, (unsigned long long)window.bad_ts,
+               (unsigned long long)window.reordered);
+        fflush(stdout);
+        window = Stats();
+    }
+    server.stop();
+    listener.join();
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("[INFO] Total: %llu requests, %llu points (%.0f points/s), %llu wire bytes, %llu rejected,"
+           " %llu bad timestamps, %llu reordered\n",
+           (unsigned long long)total.requests, (unsigned long long)total.points, total.points / secs,
+           (unsigned long long)total.wire_bytes, (unsigned long long)total.rejected,
+           (unsigned long long)total.bad_ts, (unsigned long long)total.reordered);
+    if (!json_file.empty()) {
+        FILE *f = fopen(json_file.c_str(), "w");
+        if (!f) {
+            fprintf(stderr, "[ERROR] Cannot write %s\n", json_file.c_str());
+            return 1;
+        }
+        fprintf(f, "{\"seconds\":%.3f,\"requests\":%llu,\"points\":%llu,\"points_per_s\":%.1f,"
+                   "\"wire_bytes\":%llu,\"body_bytes\":%llu,\"rejected\":%llu,\"bad_timestamps\":%llu,"
+                   "\"reordered\":%llu,\"latency_ms\":{\"mean\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f},"
+                   "\"handler_us\":{\"p50\":%.1f,\"p99\":%.1f,\"max\":%.1f}}\n",
+                secs, (unsigned long long)total.requests, (unsigned long long)total.points, total.points / secs,
+                (unsigned long long)total.wire_bytes, (unsigned long long)total.body_bytes,
+                (unsigned long long)total.rejected, (unsigned long long)total.bad_ts,
+                (unsigned long long)total.reordered, total.latency.mean() / 1e6,
+                total.latency.quantile(0.5) / 1e6, total.latency.quantile(0.9) / 1e6,
+                total.latency.quantile(0.99) / 1e6, total.latency.max() / 1e6,
+                total.handler.quantile(0.5) / 1e3, total.handler.quantile(0.99) / 1e3, total.handler.max() / 1e3);
+        fclose(f);
+    }
+    return 0;
+}
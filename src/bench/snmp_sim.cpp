@@ -0,0 +1,614 @@
+// SNMP agent simulator for load tests. Serves .snmprec data (oid|tag|value,
+// as used by SNMPSim) on many UDP ports and addresses from one epoll loop and
+// answers GET, GETNEXT and GETBULK (SNMP v1 and v2c) with hand-rolled BER.
+// Every socket is one simulated agent; counters grow with time at a rate
+// scaled per agent, responses can be delayed and requests dropped at random.
+// Linux only (epoll)
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <string>
+#include <vector>
+#include <queue>
+#include <random>
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+namespace {
+
+volatile sig_atomic_t g_stop = 0;
+void on_signal(int) { g_stop = 1; }
+
+// BER tags
+enum : uint8_t {
+    kInteger = 0x02, kOctetString = 0x04, kNull = 0x05, kObjectId = 0x06, kSequence = 0x30,
+    kIpAddress = 0x40, kCounter32 = 0x41, kGauge32 = 0x42, kTimeTicks = 0x43, kOpaque = 0x44, kCounter64 = 0x46,
+    kNoSuchObject = 0x80, kNoSuchInstance = 0x81, kEndOfMibView = 0x82,
+    kGetRequest = 0xa0, kGetNextRequest = 0xa1, kGetResponse = 0xa2, kGetBulkRequest = 0xa5,
+};
+constexpr long kNoSuchName = 2; // v1 error status
+constexpr size_t kMaxMessage = 65507;
+
+uint64_t now_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ---- BER writing ----
+
+void put_length(std::string &out, size_t len) {
+    if (len < 0x80) {
+        out += (char)len;
+        return;
+    }
+    int bytes = len > 0xffffff ? 4 : len > 0xffff ? 3 : len > 0xff ? 2 : 1;
+    out += (char)(0x80 | bytes);
+    for (int i = bytes - 1; i >= 0; --i) out += (char)((len >> (8 * i)) & 0xff);
+}
+
+void put_tlv(std::string &out, uint8_t tag, const char *data, size_t len) {
+    out += (char)tag;
+    put_length(out, len);
+    out.append(data, len);
+}
+
+void put_signed(std::string &out, uint8_t tag, int64_t v) {
+    char buf[8];
+    int n = 8;
+    for (int i = 7; i >= 0; --i, v >>= 8) buf[i] = (char)(v & 0xff);
+    // Minimal two's complement: drop leading bytes that only repeat the sign
+    int start = 0;
+    while (start < 7 && ((buf[start] == 0 && !(buf[start + 1] & 0x80)) ||
+                         (buf[start] == (char)0xff && (buf[start + 1] & 0x80)))) ++start;
+    put_tlv(out, tag, buf + start, n - start);
+}
+
+void put_unsigned(std::string &out, uint8_t tag, uint64_t v) {
+    char buf[9];
+    buf[0] = 0;
+    for (int i = 8; i >= 1; --i, v >>= 8) buf[i] = (char)(v & 0xff);
+    int start = 0;
+    while (start < 8 && buf[start] == 0 && !(buf[start + 1] & 0x80)) ++start;
+    put_tlv(out, tag, buf + start, 9 - start);
+}
+
+// Content octets of an OBJECT IDENTIFIER
+void oid_content(std::string &body, const std::vector<uint32_t> &arcs) {
+    if (arcs.size() >= 2) body += (char)(arcs[0] * 40 + arcs[1]);
+    else if (arcs.size() == 1) body += (char)(arcs[0] * 40);
+    for (size_t i = 2; i < arcs.size(); ++i) {
+        char tmp[5];
+        int n = 0;
+        uint32_t v = arcs[i];
+        do {
+            tmp[n++] = (char)(v & 0x7f);
+            v >>= 7;
+        } while (v);
+        while (n > 1) body += (char)(tmp[--n] | 0x80);
+        body += tmp[0];
+    }
+}
+
+// Encoded in place behind a one byte length, moved up in the rare case of a long form length
+void put_oid(std::string &out, const std::vector<uint32_t> &arcs) {
+    out += (char)kObjectId;
+    size_t at = out.size();
+    out += '\0';
+    oid_content(out, arcs);
+    size_t len = out.size() - at - 1;
+    if (len < 0x80) {
+        out[at] = (char)len;
+        return;
+    }
+    std::string length;
+    put_length(length, len);
+    out.replace(at, 1, length);
+}
+
+// ---- BER reading ----
+
+struct Reader {
+    const uint8_t *p;
+    const uint8_t *end;
+
+    // Reads tag and length, leaves p at the content
+    bool header(uint8_t &tag, size_t &len) {
+        if (p >= end) return false;
+        tag = *p++;
+        if (p >= end) return false;
+        size_t l = *p++;
+        if (l & 0x80) {
+            int bytes = l & 0x7f;
+            if (bytes == 0 || bytes > 4 || end - p < bytes) return false;
+            l = 0;
+            while (bytes--) l = (l << 8) | *p++;
+        }
+        if ((size_t)(end - p) < l) return false;
+        len = l;
+        return true;
+    }
+    bool integer(int64_t &v) {
+        uint8_t tag;
+        size_t len;
+        if (!header(tag, len) || tag != kInteger || len == 0 || len > 8) return false;
+        uint64_t u = (p[0] & 0x80) ? ~0ull : 0; // sign extension
+        for (size_t i = 0; i < len; ++i) u = (u << 8) | p[i];
+        v = (int64_t)u;
+        p += len;
+        return true;
+    }
+    bool octets(std::string &s) {
+        uint8_t tag;
+        size_t len;
+        if (!header(tag, len) || tag != kOctetString) return false;
+        s.assign((const char *)p, len);
+        p += len;
+        return true;
+    }
+    bool oid(std::vector<uint32_t> &arcs) {
+        uint8_t tag;
+        size_t len;
+        if (!header(tag, len) || tag != kObjectId || len == 0) return false;
+        const uint8_t *q = p, *e = p + len;
+        p = e;
+        arcs.clear();
+        uint64_t v = 0;
+        bool first = true;
+        for (; q < e; ++q) {
+            v = (v << 7) | (*q & 0x7f);
+            if (v > UINT32_MAX) return false;
+            if (*q & 0x80) continue;
+            if (first) {
+                uint32_t a0 = v < 40 ? 0 : v < 80 ? 1 : 2;
+                arcs.push_back(a0);
+                arcs.push_back((uint32_t)(v - 40 * a0));
+                first = false;
+            } else {
+                arcs.push_back((uint32_t)v);
+            }
+            v = 0;
+        }
+        return true;
+    }
+    void skip(size_t len) { p += len; }
+};
+
+// ---- Data ----
+
+struct Entry {
+    std::vector<uint32_t> arcs;
+    uint8_t tag;
+    std::string raw;  // content octets of static values
+    uint64_t base = 0; // numeric types
+};
+
+bool parse_arcs(const std::string &s, std::vector<uint32_t> &arcs) {
+    arcs.clear();
+    size_t pos = s[0] == '.' ? 1 : 0;
+    while (pos < s.size()) {
+        char *end;
+        unsigned long v = strtoul(s.c_str() + pos, &end, 10);
+        size_t next = end - s.c_str();
+        if (next == pos || v > UINT32_MAX || (next < s.size() && s[next] != '.')) return false;
+        arcs.push_back((uint32_t)v);
+        pos = next + 1;
+    }
+    return arcs.size() >= 2;
+}
+
+bool from_hex(const std::string &hex, std::string &out) {
+    if (hex.size() % 2) return false;
+    out.clear();
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        char byte[3] = {hex[i], hex[i + 1], 0};
+        char *end;
+        out += (char)strtoul(byte, &end, 16);
+        if (*end) return false;
+    }
+    return true;
+}
+
+// Reads oid|tag|value lines; tags may carry an x (hex value) or :variation suffix
+bool load_snmprec(const std::string &path, std::vector<Entry> &entries) {
+    std::ifstream in(path);
+    if (!in) {
+        fprintf(stderr, "[ERROR] Cannot open %s\n", path.c_str());
+        return false;
+    }
+    std::string line;
+    size_t lineno = 0;
+    while (std::getline(in, line)) {
+        ++lineno;
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        size_t a = line.find('|'), b = a == std::string::npos ? a : line.find('|', a + 1);
+        Entry e;
+        if (b == std::string::npos || !parse_arcs(line.substr(0, a), e.arcs)) {
+            fprintf(stderr, "[WARNING] %s:%zu: malformed line ignored\n", path.c_str(), lineno);
+            continue;
+        }
+        std::string tag = line.substr(a + 1, b - a - 1);
+        std::string value = line.substr(b + 1);
+        size_t colon = tag.find(':');
+        if (colon != std::string::npos) tag.resize(colon); // variation modules are not simulated
+        bool hex = !tag.empty() && tag.back() == 'x';
+        if (hex) tag.pop_back();
+        e.tag = (uint8_t)atoi(tag.c_str());
+        bool ok = true;
+        switch (e.tag) {
+            case kInteger: case kCounter32: case kGauge32: case kTimeTicks: case kCounter64:
+                e.base = strtoull(value.c_str(), nullptr, 10);
+                if (e.tag == kInteger) e.base = (uint64_t)strtoll(value.c_str(), nullptr, 10);
+                break;
+            case kOctetString: case kOpaque:
+                ok = hex ? from_hex(value, e.raw) : (e.raw = value, true);
+                break;
+            case kObjectId: {
+                std::vector<uint32_t> arcs;
+                ok = parse_arcs(value, arcs);
+                if (ok) oid_content(e.raw, arcs);
+                break;
+            }
+            case kIpAddress: {
+                in_addr addr;
+                ok = hex ? from_hex(value, e.raw) : inet_pton(AF_INET, value.c_str(), &addr) == 1;
+                if (ok && !hex) e.raw.assign((const char *)&addr, 4);
+                break;
+            }
+            case kNull:
+                break;
+            default:
+                ok = false;
+        }
+        if (!ok) {
+            fprintf(stderr, "[WARNING] %s:%zu: unsupported value ignored\n", path.c_str(), lineno);
+            continue;
+        }
+        entries.push_back(std::move(e));
+    }
+    return true;
+}
+
+struct Options {
+    std::string community = "public";
+    double counter_rate = 1000; // counter increase per second of agent 0
+    int latency_ms = 0;
+    int jitter_ms = 0;
+    double loss = 0; // percent of requests dropped
+};
+
+class Simulator {
+public:
+    Simulator(std::vector<Entry> entries, const Options &opts)
+    : entries_(std::move(entries)), opts_(opts), start_ns_(now_ns()), rng_(12345) {
+        std::sort(entries_.begin(), entries_.end(), [](const Entry &a, const Entry &b) { return a.arcs < b.arcs; });
+        entries_.erase(std::unique(entries_.begin(), entries_.end(),
+                                   [](const Entry &a, const Entry &b) { return a.arcs == b.arcs; }), entries_.end());
+    }
+
+    size_t size() const { return entries_.size(); }
+
+    // Builds the response to one request into out, false when it is dropped
+    bool handle(size_t agent, const uint8_t *msg, size_t len, std::string &out) {
+        Reader r{msg, msg + len};
+        uint8_t tag;
+        size_t l;
+        int64_t version, request_id, a, b;
+        if (!r.header(tag, l) || tag != kSequence || !r.integer(version) || !r.octets(community_)) return false;
+        if ((version != 0 && version != 1) || community_ != opts_.community) return false;
+        uint8_t pdu_type;
+        if (!r.header(pdu_type, l)) return false;
+        if (pdu_type != kGetRequest && pdu_type != kGetNextRequest && (pdu_type != kGetBulkRequest || version == 0))
+            return false;
+        if (!r.integer(request_id) || !r.integer(a) || !r.integer(b) || !r.header(tag, l) || tag != kSequence)
+            return false;
+        names_.clear();
+        Reader vbs{r.p, r.p + l};
+        while (vbs.p < vbs.end) {
+            size_t vl;
+            if (!vbs.header(tag, vl) || tag != kSequence) return false;
+            Reader vb{vbs.p, vbs.p + vl};
+            vbs.skip(vl);
+            names_.emplace_back();
+            if (!vb.oid(names_.back())) return false;
+        }
+
+        double elapsed = (now_ns() - start_ns_) / 1e9;
+        long error = 0, error_index = 0;
+        varbinds_.clear();
+        if (pdu_type == kGetBulkRequest) {
+            size_t non_repeaters = (size_t)std::max<int64_t>(a, 0);
+            size_t repetitions = (size_t)std::max<int64_t>(b, 0);
+            for (size_t i = 0; i < names_.size() && i < non_repeaters; ++i)
+                next_varbind(agent, elapsed, names_[i]);
+            // Repeaters walk forward together, the response stops before it gets too large
+            std::vector<std::vector<uint32_t>> cursor(names_.begin() + std::min(non_repeaters, names_.size()), names_.end());
+            for (size_t rep = 0; rep < repetitions && !cursor.empty(); ++rep) {
+                size_t before = varbinds_.size();
+                bool any = false;
+                for (auto &c : cursor) {
+                    const Entry *e = next_varbind(agent, elapsed, c);
+                    if (e) {
+                        c = e->arcs;
+                        any = true;
+                    }
+                }
+                if (varbinds_.size() > kMaxMessage - 512) {
+                    varbinds_.resize(before);
+                    break;
+                }
+                if (!any) break;
+            }
+        } else {
+            for (size_t i = 0; i < names_.size(); ++i) {
+                bool found = pdu_type == kGetRequest ? get_varbind(agent, elapsed, names_[i])
+                                                     : next_varbind(agent, elapsed, names_[i]) != nullptr;
+                if (!found && version == 0 && error == 0) {
+                    error = kNoSuchName;
+                    error_index = (long)i + 1;
+                }
+            }
+        }
+        if (error) {
+            // v1 errors echo the request's varbinds
+            varbinds_.clear();
+            for (const auto &n : names_) {
+                std::string vb;
+                put_oid(vb, n);
+                put_tlv(vb, kNull, "", 0);
+                put_tlv(varbinds_, kSequence, vb.data(), vb.size());
+            }
+        }
+
+        pdu_.clear();
+        put_signed(pdu_, kInteger, request_id);
+        put_signed(pdu_, kInteger, error);
+        put_signed(pdu_, kInteger, error_index);
+        put_tlv(pdu_, kSequence, varbinds_.data(), varbinds_.size());
+        body_.clear();
+        put_signed(body_, kInteger, version);
+        put_tlv(body_, kOctetString, community_.data(), community_.size());
+        put_tlv(body_, kGetResponse, pdu_.data(), pdu_.size());
+        out.clear();
+        put_tlv(out, kSequence, body_.data(), body_.size());
+        return out.size() <= kMaxMessage;
+    }
+
+private:
+    std::vector<Entry> entries_;
+    Options opts_;
+    uint64_t start_ns_;
+    std::mt19937 rng_;
+    // Scratch buffers reused across requests
+    std::string community_;
+    std::vector<std::vector<uint32_t>> names_;
+    std::string varbinds_, pdu_, body_, vb_;
+
+    const Entry *lookup(const std::vector<uint32_t> &arcs, bool next) const {
+        auto it = std::lower_bound(entries_.begin(), entries_.end(), arcs,
+                                   [](const Entry &e, const std::vector<uint32_t> &k) { return e.arcs < k; });
+        if (next && it != entries_.end() && it->arcs == arcs) ++it;
+        if (it == entries_.end() || (!next && it->arcs != arcs)) return nullptr;
+        return &*it;
+    }
+
+    void append_value(size_t agent, double elapsed, const Entry &e) {
+        // Agents count at different speeds so their series are distinguishable
+        double scale = 1 + agent % 8;
+        switch (e.tag) {
+            case kInteger: put_signed(vb_, kInteger, (int64_t)e.base); break;
+            case kGauge32: put_unsigned(vb_, kGauge32, e.base & 0xffffffffu); break;
+            case kTimeTicks: put_unsigned(vb_, kTimeTicks, (e.base + (uint64_t)(elapsed * 100)) & 0xffffffffu); break;
+            case kCounter32:
+                put_unsigned(vb_, kCounter32, (e.base + (uint64_t)(elapsed * opts_.counter_rate * scale)) & 0xffffffffu);
+                break;
+            case kCounter64:
+                put_unsigned(vb_, kCounter64, e.base + (uint64_t)(elapsed * opts_.counter_rate * scale));
+                break;
+            default: put_tlv(vb_, e.tag, e.raw.data(), e.raw.size()); break;
+        }
+    }
+
+    bool get_varbind(size_t agent, double elapsed, const std::vector<uint32_t> &name) {
+        const Entry *e = lookup(name, false);
+        vb_.clear();
+        put_oid(vb_, name);
+        if (e) append_value(agent, elapsed, *e);
+        else put_tlv(vb_, kNoSuchObject, "", 0);
+        put_tlv(varbinds_, kSequence, vb_.data(), vb_.size());
+        return e != nullptr;
+    }
+
+    const Entry *next_varbind(size_t agent, double elapsed, const std::vector<uint32_t> &name) {
+        const Entry *e = lookup(name, true);
+        vb_.clear();
+        if (e) {
+            put_oid(vb_, e->arcs);
+            append_value(agent, elapsed, *e);
+        } else {
+            put_oid(vb_, name);
+            put_tlv(vb_, kEndOfMibView, "", 0);
+        }
+        put_tlv(varbinds_, kSequence, vb_.data(), vb_.size());
+        return e;
+    }
+};
+
+// "16100-16199" or "161"
+bool parse_range(const char *s, int &lo, int &hi) {
+    char *end;
+    lo = (int)strtol(s, &end, 10);
+    hi = lo;
+    if (*end == '-') hi = (int)strtol(end + 1, &end, 10);
+    return *end == 0 && lo > 0 && hi >= lo && hi <= 65535;
+}
+
+struct Delayed {
+    uint64_t due_ns;
+    int fd;
+    sockaddr_storage addr;
+    socklen_t addr_len;
+    std::string msg;
+    bool operator>(const Delayed &o) const { return due_ns > o.due_ns; }
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::vector<std::string> files;
+    std::vector<std::string> addresses;
+    int port_lo = 16100, port_hi = 16100;
+    int stats_s = 0;
+    Options opts;
+    static const struct option long_opts[] = {
+        {"data", required_argument, nullptr, 'd'},
+        {"address", required_argument, nullptr, 'a'},
+        {"ports", required_argument, nullptr, 'p'},
+        {"community", required_argument, nullptr, 'c'},
+        {"latency-ms", required_argument, nullptr, 'l'},
+        {"jitter-ms", required_argument, nullptr, 'j'},
+        {"loss", required_argument, nullptr, 'L'},
+        {"counter-rate", required_argument, nullptr, 'r'},
+        {"stats", required_argument, nullptr, 's'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "d:a:p:c:l:j:L:r:s:", long_opts, nullptr)) != -1) {
+        switch (opt) {
+            case 'd': files.push_back(optarg); break;
+            case 'a': addresses.push_back(optarg); break;
+            case 'p':
+                if (!parse_range(optarg, port_lo, port_hi)) {
+                    fprintf(stderr, "[ERROR] Invalid port range %s\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'c': opts.community = optarg; break;
+            case 'l': opts.latency_ms = atoi(optarg); break;
+            case 'j': opts.jitter_ms = atoi(optarg); break;
+            case 'L': opts.loss = atof(optarg); break;
+            case 'r': opts.counter_rate = atof(optarg); break;
+            case 's': stats_s = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: snmp_sim --data file.snmprec [--data ...] [--address ip] [--ports lo-hi]\n"
+                                "       [--community c] [--latency-ms n] [--jitter-ms n] [--loss pct]\n"
+                                "       [--counter-rate per_s] [--stats s]\n");
+                return 2;
+        }
+    }
+    if (files.empty()) files.push_back("data/sim_data.snmprec");
+    if (addresses.empty()) addresses.push_back("127.0.0.1");
+
+    std::vector<Entry> entries;
+    for (const auto &f : files)
+        if (!load_snmprec(f, entries)) return 1;
+    Simulator sim(std::move(entries), opts);
+    if (sim.size() == 0) {
+        fprintf(stderr, "[ERROR] No objects loaded\n");
+        return 1;
+    }
+
+    int ep = epoll_create1(0);
+    std::vector<int> sockets;
+    for (const auto &address : addresses) {
+        for (int port = port_lo; port <= port_hi; ++port) {
+            sockaddr_in sa{};
+            sa.sin_family = AF_INET;
+            sa.sin_port = htons((uint16_t)port);
+            if (inet_pton(AF_INET, address.c_str(), &sa.sin_addr) != 1) {
+                fprintf(stderr, "[ERROR] Invalid address %s\n", address.c_str());
+                return 1;
+            }
+            int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+            if (fd < 0 || bind(fd, (sockaddr *)&sa, sizeof(sa)) != 0) {
+                fprintf(stderr, "[ERROR] Cannot bind %s:%d: %s\n", address.c_str(), port, strerror(errno));
+                return 1;
+            }
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.u64 = sockets.size();
+            epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+            sockets.push_back(fd);
+        }
+    }
+    printf("[INFO] Serving %zu objects as %zu agents (%s, ports %d-%d)\n", sim.size(), sockets.size(),
+           addresses.size() == 1 ? addresses[0].c_str() : "several addresses", port_lo, port_hi);
+    fflush(stdout);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    std::priority_queue<Delayed, std::vector<Delayed>, std::greater<Delayed>> delayed;
+    std::mt19937 rng(std::random_device{}());
+    std::uniform_real_distribution<double> percent(0, 100);
+    std::uniform_int_distribution<int> jitter(0, std::max(opts.jitter_ms, 0));
+    uint64_t requests = 0, responses = 0, dropped = 0, invalid = 0;
+    uint64_t last_requests = 0, next_stats = now_ns() + (uint64_t)stats_s * 1000000000ull;
+    std::vector<epoll_event> events(256);
+    std::vector<uint8_t> buf(kMaxMessage + 1);
+    std::string out;
+
+    while (!g_stop) {
+        int timeout = 1000;
+        if (!delayed.empty()) {
+            uint64_t now = now_ns();
+            timeout = delayed.top().due_ns <= now ? 0 : (int)std::min<uint64_t>((delayed.top().due_ns - now) / 1000000 + 1, 1000);
+        }
+        int n = epoll_wait(ep, events.data(), (int)events.size(), timeout);
+        if (n < 0 && errno != EINTR) break;
+        for (int i = 0; i < n; ++i) {
+            size_t agent = events[i].data.u64;
+            int fd = sockets[agent];
+            for (;;) {
+                sockaddr_storage from;
+                socklen_t from_len = sizeof(from);
+                ssize_t len = recvfrom(fd, buf.data(), buf.size(), 0, (sockaddr *)&from, &from_len);
+                if (len < 0) break; // EAGAIN, drained
+                ++requests;
+                if (opts.loss > 0 && percent(rng) < opts.loss) {
+                    ++dropped;
+                    continue;
+                }
+                if (!sim.handle(agent, buf.data(), (size_t)len, out)) {
+                    ++invalid;
+                    continue;
+                }
+                if (opts.latency_ms > 0 || opts.jitter_ms > 0) {
+                    uint64_t delay = (uint64_t)(opts.latency_ms + jitter(rng)) * 1000000ull;
+                    delayed.push(Delayed{now_ns() + delay, fd, from, from_len, out});
+                } else {
+                    sendto(fd, out.data(), out.size(), 0, (sockaddr *)&from, from_len);
+                    ++responses;
+                }
+            }
+        }
+        uint64_t now = now_ns();
+        while (!delayed.empty() && delayed.top().due_ns <= now) {
+            const Delayed &d = delayed.top();
+            sendto(d.fd, d.msg.data(), d.msg.size(), 0, (const sockaddr *)&d.addr, d.addr_len);
+            ++responses;
+            delayed.pop();
+        }
+        if (stats_s > 0 && now >= next_stats) {
+            printf("[INFO] %.0f requests/s, %llu responses, %llu dropped, %llu invalid\n",
+                   double(requests - last_requests) / stats_s, (unsigned long long)responses,
+                   (unsigned long long)dropped, (unsigned long long)invalid);
+            fflush(stdout);
+            last_requests = requests;
+            next_stats = now + (uint64_t)stats_s * 1000000000ull;
+        }
+    }
+    printf("[INFO] %llu requests, %llu responses, %llu dropped, %llu invalid\n", (unsigned long long)requests,
+           (unsigned long long)responses, (unsigned long long)dropped, (unsigned long long)invalid);
+    for (int fd : sockets) close(fd);
+    close(ep);
+    return 0;
+}
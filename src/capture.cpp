@@ -0,0 +1,209 @@
+#include "capture.hpp"
+#include "log.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+const char kMagic[CaptureReader::kMagicLen] = {'S', '2', 'O', 'C', 'A', 'P', '2', '\n'};
+
+struct RecordHeader {
+    uint32_t len;
+    uint32_t kind;
+    uint64_t ts;
+};
+
+constexpr size_t kEntryLen = 4 + 1 + 8 + 8; // id, type, value, timestamp
+constexpr size_t kFlushBytes = 1 << 20;
+
+template <class T>
+void put(std::string &out, T v) {
+    out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+template <class T>
+T get(const char *p) {
+    T v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+bool write_all(int fd, const char *p, size_t n) {
+    while (n > 0) {
+        ssize_t w = ::write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += w; n -= (size_t)w;
+    }
+    return true;
+}
+
+} // namespace
+
+CaptureWriter::CaptureWriter(const std::string &path)
+: path_(path) {}
+
+CaptureWriter::~CaptureWriter() {
+    flush();
+    if (fd_ >= 0) ::close(fd_);
+}
+
+bool CaptureWriter::open() {
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd_ < 0) {
+        LOG_ERROR("Cannot create capture file {}: {}", path_, strerror(errno));
+        return false;
+    }
+    buf_.assign(kMagic, sizeof(kMagic));
+    return flush();
+}
+
+void CaptureWriter::record(uint32_t kind, uint64_t ts, const std::string &payload) {
+    put(buf_, RecordHeader{(uint32_t)payload.size(), kind, ts});
+    buf_ += payload;
+}
+
+bool CaptureWriter::write(const SampleBatch &batch, const SeriesRegistry &reg) {
+    if (fd_ < 0) return false;
+    if (defined_.size() < reg.size()) defined_.resize(reg.size(), false);
+    std::string payload;
+    for (size_t begin = 0; begin < batch.size();) {
+        // One Response per run of one target, whatever the times of its samples
+        uint32_t target = reg.target(batch.series[begin]);
+        uint64_t ts = batch.ts[begin];
+        size_t end = begin + 1;
+        while (end < batch.size() && reg.target(batch.series[end]) == target) ++end;
+
+        for (size_t row = begin; row < end; ++row) {
+            SeriesId id = batch.series[row];
+            if (defined_[id]) continue;
+            const std::string &name = reg.target_name(target);
+            const std::string &oid = reg.oid_str(id);
+            payload.clear();
+            put(payload, (uint32_t)id);
+            put(payload, (uint16_t)name.size());
+            put(payload, (uint16_t)oid.size());
+            payload += name;
+            payload += oid;
+            record(capture::Define, ts, payload);
+            defined_[id] = true;
+        }
+        payload.clear();
+        put(payload, (uint32_t)(end - begin));
+        for (size_t row = begin; row < end; ++row) {
+            put(payload, (uint32_t)batch.series[row]);
+            put(payload, (uint8_t)batch.type[row]);
+            put(payload, batch.value[row]);
+            put(payload, batch.ts[row]);
+        }
+        record(capture::Response, ts, payload);
+        begin = end;
+    }
+    return buf_.size() < kFlushBytes || flush();
+}
+
+bool CaptureWriter::flush() {
+    if (fd_ < 0 || buf_.empty()) return true;
+    bool ok = write_all(fd_, buf_.data(), buf_.size());
+    if (!ok) LOG_ERROR("Capture write failed: {}", strerror(errno));
+    buf_.clear();
+    return ok;
+}
+
+CaptureReader::CaptureReader(const std::string &path)
+: path_(path) {}
+
+CaptureReader::~CaptureReader() {
+    if (base_) munmap(const_cast<char *>(base_), size_);
+}
+
+bool CaptureReader::open() {
+    int fd = ::open(path_.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR("Cannot open capture file {}: {}", path_, strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < kMagicLen) {
+        ::close(fd);
+        LOG_ERROR("{} is not a capture file", path_);
+        return false;
+    }
+    size_ = (size_t)st.st_size;
+    void *map = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        LOG_ERROR("Cannot map capture file {}: {}", path_, strerror(errno));
+        return false;
+    }
+    base_ = static_cast<const char *>(map);
+    // Replay walks the file once front to back
+    madvise(map, size_, MADV_SEQUENTIAL);
+    if (memcmp(base_, kMagic, kMagicLen) != 0) {
+        LOG_ERROR("{} is not a capture file", path_);
+        return false;
+    }
+    off_ = kMagicLen;
+    return true;
+}
+
+bool CaptureReader::next(Record &rec) {
+    if (!base_ || off_ + sizeof(RecordHeader) > size_) return false;
+    RecordHeader h = get<RecordHeader>(base_ + off_);
+    if (off_ + sizeof(h) + h.len > size_) {
+        LOG_WARNING("Capture {} ends with a torn record", path_);
+        off_ = size_;
+        return false;
+    }
+    rec = Record{h.kind, h.ts, base_ + off_ + sizeof(h), h.len};
+    off_ += sizeof(h) + h.len;
+    return true;
+}
+
+bool capture_intern(CaptureReader &reader, SeriesRegistry &reg, const OIDMapping &mapping,
+                    std::vector<SeriesId> &remap) {
+    CaptureReader::Record rec;
+    reader.rewind();
+    while (reader.next(rec)) {
+        if (rec.kind != capture::Define || rec.len < 8) continue;
+        uint32_t id = get<uint32_t>(rec.payload);
+        uint16_t name_len = get<uint16_t>(rec.payload + 4);
+        uint16_t oid_len = get<uint16_t>(rec.payload + 6);
+        if (8u + name_len + oid_len > rec.len) return false;
+        std::string name(rec.payload + 8, name_len);
+        std::string oid(rec.payload + 8 + name_len, oid_len);
+        if (remap.size() <= id) remap.resize(id + 1, kInvalidSeries);
+        uint32_t target = reg.intern_target(name);
+        // The reachability series has no OID
+        remap[id] = oid == "up" ? reg.intern(target, oid, nullptr, 0, mapping) : reg.intern(target, oid, mapping);
+    }
+    reader.rewind();
+    return true;
+}
+
+SeriesId capture_first(const CaptureReader::Record &rec, const std::vector<SeriesId> &remap) {
+    if (rec.kind != capture::Response || rec.len < 4 + kEntryLen || get<uint32_t>(rec.payload) == 0) return kInvalidSeries;
+    uint32_t id = get<uint32_t>(rec.payload + 4);
+    return id < remap.size() ? remap[id] : kInvalidSeries;
+}
+
+size_t capture_append(const CaptureReader::Record &rec, const std::vector<SeriesId> &remap, SampleBatch &out) {
+    if (rec.kind != capture::Response || rec.len < 4) return 0;
+    uint32_t count = get<uint32_t>(rec.payload);
+    if (4 + (size_t)count * kEntryLen > rec.len) return 0;
+    size_t added = 0;
+    const char *p = rec.payload + 4;
+    for (uint32_t i = 0; i < count; ++i, p += kEntryLen) {
+        uint32_t id = get<uint32_t>(p);
+        if (id >= remap.size() || remap[id] == kInvalidSeries) continue;
+        out.append(remap[id], get<uint64_t>(p + 13), (SampleType)get<uint8_t>(p + 4), get<int64_t>(p + 5));
+        ++added;
+    }
+    return added;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "series.hpp"
+#include "sample_batch.hpp"
+
+// Append-only binary capture of poll results for benchmarking the pipeline
+// without devices. Layout: 8 byte magic, then records of
+//   [u32 payload length][u32 kind][u64 unix nano][payload]
+// Define records name a series once ([u32 id][u16 target len][u16 oid len][target][oid]),
+// Response records hold one target's samples of a batch ([u32 count] then
+// count x [u32 id][u8 type][i64 value][u64 unix nano]) with the first timestamp
+// in the record header. A target's PDUs and its up sample are stamped apart,
+// so they stay one record and replay as the series set that was polled
+namespace capture {
+enum Kind : uint32_t { Define = 1, Response = 2 };
+}
+
+class CaptureWriter {
+public:
+    explicit CaptureWriter(const std::string &path);
+    ~CaptureWriter();
+    // Truncates the file and writes the magic
+    bool open();
+    // Appends one Response record per target run of the batch
+    bool write(const SampleBatch &batch, const SeriesRegistry &reg);
+    bool flush();
+
+private:
+    std::string path_;
+    int fd_ = -1;
+    std::string buf_; // records not yet written
+    std::vector<bool> defined_; // by SeriesId
+
+    void record(uint32_t kind, uint64_t ts, const std::string &payload);
+};
+
+// Reads a capture through a read-only mapping of the whole file
+class CaptureReader {
+public:
+    struct Record {
+        uint32_t kind;
+        uint64_t ts;
+        const char *payload;
+        uint32_t len;
+    };
+
+    explicit CaptureReader(const std::string &path);
+    ~CaptureReader();
+    bool open();
+    // Next complete record, false at the end or at a torn tail
+    bool next(Record &rec);
+    void rewind() { off_ = kMagicLen; }
+
+    static constexpr size_t kMagicLen = 8;
+
+private:
+    std::string path_;
+    const char *base_ = nullptr;
+    size_t size_ = 0;
+    size_t off_ = kMagicLen;
+};
+
+// Interns the series of every Define record into reg, remap[capture id] is the SeriesId
+bool capture_intern(CaptureReader &reader, SeriesRegistry &reg, const OIDMapping &mapping,
+                    std::vector<SeriesId> &remap);
+// SeriesId of the first sample of a Response record, kInvalidSeries when there is none
+SeriesId capture_first(const CaptureReader::Record &rec, const std::vector<SeriesId> &remap);
+// Appends the samples of a Response record to out, returns the number appended
+size_t capture_append(const CaptureReader::Record &rec, const std::vector<SeriesId> &remap, SampleBatch &out);
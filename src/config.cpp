@@ -0,0 +1,143 @@
+#include "config.hpp"
+#include "snapshot.hpp"
+#include "snmp.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <map>
+
+std::shared_ptr<Config> load_config(const ConfigSources &src, const std::vector<std::string> &targets,
+                                    const Config *prev) {
+    auto cfg = std::make_shared<Config>();
+    if (prev) cfg->version = prev->version + 1;
+
+    // OIDs are parsed once (symbolic names through the MIBs, arcs stay empty
+    // when unknown), from the snapshot when it is fresh, otherwise from the text files
+    std::vector<std::string> oids;
+    std::vector<std::vector<uint32_t>> oid_arcs;
+    ConfigSnapshot snapshot;
+    if (!src.snapshot_file.empty() && snapshot.open(src.snapshot_file, src.oids_file, src.mapping_file)) {
+        for (size_t i = 0; i < snapshot.oid_count(); ++i) {
+            oids.push_back(snapshot.oid(i));
+            oid_arcs.emplace_back(snapshot.arcs(i), snapshot.arcs(i) + snapshot.arcs_len(i));
+        }
+        cfg->mapping = snapshot.mapping();
+    } else {
+        if (!src.oids_file.empty()) oids = load_oids_file(src.oids_file);
+        if (!src.mapping_file.empty()) {
+            auto info = load_oids_info(src.mapping_file);
+            if (prev && info.empty()) {
+                LOG_ERROR("Mapping file {} is empty or invalid, keeping the current configuration", src.mapping_file);
+                return nullptr;
+            }
+            cfg->mapping = OIDMapping(info);
+        }
+        std::vector<uint32_t> arcs;
+        for (const auto &oid : oids) {
+            if (!parse_oid(oid, arcs) && !resolve_oid(oid, arcs)) arcs.clear();
+            oid_arcs.push_back(arcs);
+        }
+    }
+
+    // Profile objects come with their arcs, the strings are only built for naming
+    std::vector<const DeviceProfile *> used;
+    for (const auto &list : src.profiles)
+        for (const DeviceProfile *p : list)
+            if (std::find(used.begin(), used.end(), p) == used.end()) used.push_back(p);
+    if (!targets.empty() && oids.empty() && used.empty()) {
+        LOG_ERROR("No OIDs loaded from {}", src.oids_file);
+        return nullptr;
+    }
+    // Below the mapping file: the built-in profiles, then the object types of the MIB index
+    std::shared_ptr<OIDMapping> mib_rules;
+    if (src.mib_index) mib_rules = src.mib_index->mapping(oid_arcs);
+    if (!used.empty()) {
+        std::shared_ptr<OIDMapping> profiles = profile_mapping(used);
+        if (mib_rules) profiles->set_fallback(mib_rules);
+        cfg->mapping.set_fallback(profiles);
+    } else if (mib_rules) {
+        cfg->mapping.set_fallback(mib_rules);
+    }
+    size_t file_oids = oids.size();
+    std::map<const DeviceProfile *, std::vector<size_t>> profile_oids;
+    for (const DeviceProfile *p : used) {
+        auto &list = profile_oids[p];
+        size_t skipped = 0;
+        for (size_t i = 0; i < p->object_count; ++i) {
+            const ProfileObject &o = p->objects[i];
+            std::vector<uint32_t> arcs(o.oid.arcs, o.oid.arcs + o.oid.len);
+            std::string oid;
+            for (uint8_t a = 0; a < o.oid.len; ++a) {
+                if (a > 0) oid += '.';
+                oid += std::to_string(o.oid.arcs[a]);
+            }
+            int rows = !o.column ? 0 : o.rows ? o.rows : src.profile_rows;
+            if (o.column && rows <= 0) ++skipped;
+            for (int row = o.column ? 1 : 0; row <= rows; ++row) {
+                list.push_back(oids.size());
+                oids.push_back(o.column ? oid + "." + std::to_string(row) : oid);
+                oid_arcs.push_back(arcs);
+                if (o.column) oid_arcs.back().push_back((uint32_t)row);
+            }
+        }
+        if (skipped)
+            LOG_WARNING("Profile {}: {} table columns are not polled, --profile-rows is {}", p->name, skipped,
+                        src.profile_rows);
+    }
+
+    // Filter the OIDs once and intern every (target, OID) pair into a series ID
+    std::vector<size_t> requested;
+    for (size_t i = 0; i < file_oids; ++i) {
+        if (oid_arcs[i].empty()) {
+            LOG_ERROR("Failed to convert OID: {}", oids[i]);
+        } else if (is_requestable(oid_arcs[i].data(), oid_arcs[i].size(), cfg->mapping)) {
+            requested.push_back(i);
+        } else {
+            LOG_WARNING("OID: {} is not supported. Only scalar OID ending with .0 and rows of mapped tables are.", oids[i]);
+        }
+    }
+    if (prev) {
+        cfg->registry = prev->registry;
+        cfg->registry.remap(cfg->mapping);
+    }
+    for (size_t n = 0; n < targets.size(); ++n) {
+        uint32_t t = cfg->registry.intern_target(targets[n]);
+        if (cfg->series.size() <= t) cfg->series.resize(t + 1);
+        // Not an OID, so it never matches a mapping rule and keeps the name "up"
+        if (cfg->up.size() <= t) cfg->up.resize(t + 1, kInvalidSeries);
+        cfg->up[t] = cfg->registry.intern(t, "up", nullptr, 0, cfg->mapping);
+        for (size_t i : requested)
+            cfg->series[t].push_back(cfg->registry.intern(t, oids[i], oid_arcs[i].data(), oid_arcs[i].size(), cfg->mapping));
+        if (n >= src.profiles.size() || src.profiles[n].empty()) continue;
+        // A profile object also listed in the OID file (or in two profiles) is polled once
+        std::vector<bool> polled(cfg->registry.size());
+        for (SeriesId id : cfg->series[t]) polled[id] = true;
+        for (const DeviceProfile *p : src.profiles[n])
+            for (size_t i : profile_oids[p]) {
+                SeriesId id = cfg->registry.intern(t, oids[i], oid_arcs[i].data(), oid_arcs[i].size(), cfg->mapping);
+                if (id >= polled.size()) polled.resize(id + 1);
+                if (!polled[id]) cfg->series[t].push_back(id);
+                polled[id] = true;
+            }
+    }
+    return cfg;
+}
+
+ConfigWatcher::ConfigWatcher(const std::vector<std::string> &paths)
+: paths_(paths) {
+    loaded_ = read();
+    last_ = loaded_;
+    loading_ = loaded_;
+}
+
+std::vector<ConfigWatcher::Stamp> ConfigWatcher::read() const {
+    std::vector<Stamp> out(paths_.size());
+    for (size_t i = 0; i < paths_.size(); ++i) file_stamp(paths_[i], out[i].size, out[i].mtime_ns);
+    return out;
+}
+
+bool ConfigWatcher::changed() {
+    std::vector<Stamp> now = read();
+    bool stable = now == last_;
+    last_ = now;
+    return stable && now != loaded_;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "mapping.hpp"
+#include "series.hpp"
+#include "profiles.hpp"
+#include "mib_index.hpp"
+
+// One immutable version of the polling configuration. Pollers and the exporter
+// hold a shared_ptr to the version they work with; a reload builds the next
+// version beside it and publishes it with an atomic pointer swap (RCU style).
+// In-flight cycles finish on the old version, which is freed with its last user
+struct Config {
+    uint64_t version = 1;
+    OIDMapping mapping;
+    SeriesRegistry registry;
+    std::vector<std::vector<SeriesId>> series; // polled series by target id
+    std::vector<SeriesId> up; // reachability series ("up", 1 or 0) by target id, not polled
+};
+
+// Rows of profile columns polled when --profile-rows is not given (interfaces, disks, ...)
+constexpr int kDefaultProfileRows = 8;
+
+struct ConfigSources {
+    std::string oids_file;
+    std::string mapping_file;
+    std::string snapshot_file; // preferred over the text files when fresh
+    std::vector<std::vector<const DeviceProfile *>> profiles; // built-in profiles by target position
+    int profile_rows = kDefaultProfileRows; // rows polled of profile columns without a fixed row count
+    std::shared_ptr<const MibIndex> mib_index; // names and units of OIDs the mapping file lacks
+};
+
+// Loads a configuration version for the given targets. With prev the registry
+// is carried over so series keep their IDs, and a mapping file that fails to
+// load is an error instead of an empty mapping. Objects of the targets'
+// profiles are polled beside the OID list, the mapping file overrides their
+// names. Returns nullptr on error
+std::shared_ptr<Config> load_config(const ConfigSources &src, const std::vector<std::string> &targets,
+                                    const Config *prev);
+
+// Detects edits of the configuration files by polling size and mtime.
+// A change is reported once the files were stable for one more check,
+// so a file still being written is not picked up half way. Until a reload
+// succeeds the files keep being reported as changed
+class ConfigWatcher {
+public:
+    explicit ConfigWatcher(const std::vector<std::string> &paths);
+    bool changed();
+    // Call before reading the files for a reload, and loaded() once it succeeded
+    void loading() { loading_ = read(); }
+    void loaded() { loaded_ = loading_; }
+
+private:
+    struct Stamp {
+        uint64_t size;
+        int64_t mtime_ns;
+        bool operator==(const Stamp &o) const { return size == o.size && mtime_ns == o.mtime_ns; }
+        bool operator!=(const Stamp &o) const { return !(*this == o); }
+    };
+    std::vector<std::string> paths_;
+    std::vector<Stamp> loaded_; // stamps of the version in use
+    std::vector<Stamp> last_; // stamps seen by the previous check
+    std::vector<Stamp> loading_; // stamps of the version being loaded
+    std::vector<Stamp> read() const;
+};
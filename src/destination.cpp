@@ -0,0 +1,216 @@
+#include "destination.hpp"
+#include "utils.hpp"
+#include "telemetry.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <chrono>
+#include <httplib.h>
+#include <sys/stat.h>
+
+const std::string &Payload::gzip() const {
+    std::call_once(gzip_once_, [this]() {
+        if (!json_.empty()) gzip_compress(json_, gzip_);
+    });
+    return gzip_;
+}
+
+Destination::Destination(const std::string &spec, size_t max_queue)
+: max_queue_(max_queue) {
+    endpoint_ = spec;
+    size_t hash = spec.find('#');
+    if (hash != std::string::npos) {
+        std::string option = spec.substr(hash + 1);
+        endpoint_ = spec.substr(0, hash);
+        if (option == "gzip") gzip_ = true;
+        else LOG_WARNING("Unknown endpoint option '{}' ignored", option);
+    }
+    valid_ = parse_endpoint(endpoint_, host_, port_, path_);
+    if (!valid_) LOG_ERROR("Unsupported endpoint format: {}", endpoint_);
+}
+
+Destination::~Destination() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    if (sender_.joinable()) sender_.join();
+    // Keep undelivered payloads for the next run
+    if (spool_) spill();
+}
+
+bool Destination::enable_spool(const SpoolOptions &opts) {
+    // Every destination spools into its own subdirectory named after the endpoint
+    std::string name = "dest-";
+    for (char c : endpoint_.substr(std::min<size_t>(7, endpoint_.size())))
+        name += isalnum((unsigned char)c) ? c : '_';
+    mkdir(opts.dir.c_str(), 0755);
+    spool_.reset(new Spool(opts.dir + "/" + name, opts.max_bytes, opts.max_age_s, opts.sync_ms));
+    return spool_->open();
+}
+
+bool Destination::parse_endpoint(const std::string &endpoint, std::string &host, int &port, std::string &path) {
+    // support: http://host:port/path
+    if (endpoint.rfind("http://",0) != 0) {
+        LOG_WARNING("Only http:// endpoints supported in this implementation");
+        return false;
+    }
+    size_t p = 7;
+    size_t slash = endpoint.find('/', p);
+    std::string hostport = (slash==std::string::npos) ? endpoint.substr(p) : endpoint.substr(p, slash - p);
+    path = (slash==std::string::npos) ? "/" : endpoint.substr(slash);
+    size_t colon = hostport.find(':');
+    if (colon==std::string::npos) {
+        host = hostport;
+        port = 80;
+    } else {
+        host = hostport.substr(0, colon);
+        port = atoi(hostport.substr(colon+1).c_str());
+    }
+    return !host.empty() && port > 0;
+}
+
+bool Destination::http_post(const std::string &body) {
+    httplib::Client cli(host_, port_);
+    cli.set_keep_alive(false);
+    cli.set_connection_timeout(std::chrono::milliseconds(kConnectTimeoutMs));
+    cli.set_read_timeout(std::chrono::milliseconds(kIoTimeoutMs));
+    cli.set_write_timeout(std::chrono::milliseconds(kIoTimeoutMs));
+
+    httplib::Headers headers;
+    if (gzip_) headers.emplace("Content-Encoding", "gzip");
+    telemetry::add(telemetry::ExportRequests);
+    telemetry::add(telemetry::ExportBytes, body.size());
+    telemetry::record(telemetry::PayloadBytes, body.size());
+    uint64_t start = telemetry::now_ns();
+    auto res = cli.Post(path_.c_str(), headers, body, "application/json");
+    telemetry::record(telemetry::HttpLatencyNs, telemetry::now_ns() - start);
+
+    if (!res) {
+        telemetry::add(telemetry::ExportFailures);
+        LOG_ERROR("HTTP request to {} failed (network)", endpoint_);
+        return false;
+    }
+
+    LOG_DEBUG("HTTP status {} from {}: {}", res->status, endpoint_, res->body);
+
+    bool ok = res->status >= 200 && res->status < 300;
+    if (!ok) telemetry::add(telemetry::ExportFailures);
+    return ok;
+}
+
+bool Destination::deliver(const std::shared_ptr<const Payload> &payload) {
+    if (!valid_) return false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!sender_.joinable()) sender_ = std::thread(&Destination::run, this);
+        queue_.push_back(payload);
+        while (queue_.size() > max_queue_) {
+            queue_.pop_front();
+            ++dropped_;
+            telemetry::add(telemetry::DroppedPayloads);
+            LOG_LIMITED(Warning, endpoint_, "Queue for {} full, dropping oldest payload", endpoint_);
+        }
+    }
+    wake_.notify_one();
+    return true;
+}
+
+bool Destination::drain() {
+    if (!valid_) return false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!sender_.joinable()) sender_ = std::thread(&Destination::run, this);
+    }
+    wake_.notify_one();
+    return true;
+}
+
+size_t Destination::queued() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+void Destination::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        if (queue_.empty() && (!spool_ || spool_->empty())) {
+            wake_.wait(lock);
+            continue;
+        }
+        uint64_t now = now_unix_nano();
+        if (now < retry_at_ns_) {
+            // Payloads arriving during the backoff wait in the spool
+            uint64_t wake_at = retry_at_ns_;
+            if (spool_) {
+                bool spill_queue = !queue_.empty();
+                lock.unlock();
+                if (spill_queue) spill();
+                // Appends stop during an outage, the last ones are synced within the window
+                uint64_t sync_at = spool_->sync_if_due(now_unix_nano());
+                if (sync_at) wake_at = std::min(wake_at, sync_at);
+                lock.lock();
+            }
+            now = now_unix_nano();
+            if (wake_at > now) wake_.wait_for(lock, std::chrono::nanoseconds(wake_at - now));
+            continue;
+        }
+        lock.unlock();
+        send_pending();
+        lock.lock();
+    }
+    lock.unlock();
+    // One last attempt at shutdown unless the endpoint is backing off
+    if (now_unix_nano() >= retry_at_ns_) send_pending();
+}
+
+bool Destination::send_pending() {
+    // Older spooled payloads go first so the collector sees them in order
+    if (spool_ && !spool_->empty()) {
+        size_t sent = spool_->replay([this](const std::string &p) { return http_post(p); });
+        if (sent) LOG_INFO("Replayed {} spooled payload(s) to {}", sent, endpoint_);
+        if (!spool_->empty()) {
+            fail();
+            return false;
+        }
+    }
+    for (;;) {
+        std::shared_ptr<const Payload> p;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (queue_.empty()) break;
+            p = queue_.front();
+        }
+        if (!http_post(encoded(*p))) {
+            LOG_ERROR("Export failed for endpoint {}", endpoint_);
+            fail();
+            return false;
+        }
+        // Unless a full queue dropped it while it was being sent
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!queue_.empty() && queue_.front() == p) queue_.pop_front();
+    }
+    backoff_ms_ = 0;
+    return true;
+}
+
+void Destination::fail() {
+    backoff_ms_ = backoff_ms_ ? std::min(backoff_ms_ * 2, kBackoffMaxMs) : kBackoffMinMs;
+    retry_at_ns_ = now_unix_nano() + (uint64_t)backoff_ms_ * 1000000ull;
+    if (spool_) spill();
+    LOG_WARNING("{} unavailable, next retry in {} ms", endpoint_, backoff_ms_);
+}
+
+void Destination::spill() {
+    std::deque<std::shared_ptr<const Payload>> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending.swap(queue_);
+    }
+    for (const auto &p : pending) {
+        if (!spool_->append(encoded(*p))) {
+            ++dropped_;
+            telemetry::add(telemetry::DroppedPayloads);
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include "spool.hpp"
+
+// Serialized export request shared by all destinations.
+// The gzip form is produced once on first use and reused by every destination that wants it
+class Payload {
+public:
+    explicit Payload(std::string json) : json_(std::move(json)) {}
+    const std::string &json() const { return json_; }
+    const std::string &gzip() const;
+private:
+    std::string json_;
+    mutable std::string gzip_;
+    mutable std::once_flag gzip_once_; // sender threads ask concurrently
+};
+
+// One export endpoint with its own compression, queue, retry and spool state.
+// Payloads are sent by a thread of the destination, so a slow or dead endpoint
+// only backs up its own queue, never the exporter or the other endpoints.
+// Endpoint spec: http://host:port/path[#gzip]
+class Destination {
+public:
+    Destination(const std::string &spec, size_t max_queue);
+    // Stops the sender and spools what it could not deliver
+    ~Destination();
+    bool valid() const { return valid_; }
+    const std::string &endpoint() const { return endpoint_; }
+    // Failed payloads are written to the spool and replayed once the endpoint recovers.
+    // Call before the first deliver()
+    bool enable_spool(const SpoolOptions &opts);
+    // Queues the payload for the sender, dropping the oldest one when the queue is full
+    bool deliver(const std::shared_ptr<const Payload> &payload);
+    // Wakes the sender to retry queued and spooled payloads whose backoff elapsed
+    bool drain();
+    size_t dropped() const { return dropped_; }
+    size_t queued() const;
+
+private:
+    std::string endpoint_;
+    std::string host_;
+    int port_ = 80;
+    std::string path_;
+    bool gzip_ = false;
+    bool valid_ = false;
+    size_t max_queue_;
+    mutable std::mutex mutex_; // queue_ and stop_, shared with the sender
+    std::condition_variable wake_;
+    std::deque<std::shared_ptr<const Payload>> queue_;
+    bool stop_ = false;
+    std::thread sender_; // started by the first deliver() or drain()
+    std::unique_ptr<Spool> spool_; // only used by the sender once it runs
+    std::atomic<size_t> dropped_{0};
+    // Exponential backoff between retries, sender only
+    uint64_t retry_at_ns_ = 0;
+    int backoff_ms_ = 0;
+    static constexpr int kBackoffMinMs = 1000;
+    static constexpr int kBackoffMaxMs = 300000;
+    // Bounds a request to an endpoint that does not answer
+    static constexpr int kConnectTimeoutMs = 3000;
+    static constexpr int kIoTimeoutMs = 10000;
+
+    const std::string &encoded(const Payload &p) const { return gzip_ ? p.gzip() : p.json(); }
+    void run();
+    bool send_pending();
+    void fail();
+    void spill();
+    bool http_post(const std::string &body);
+    bool parse_endpoint(const std::string &endpoint, std::string &host, int &port, std::string &path);
+};
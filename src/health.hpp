@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <algorithm>
+
+// Circuit breaker of one target. After down_after consecutive unreachable
+// polls the target is down: full polls stop and a single cheap probe is sent
+// instead, first after backoff_min, then at doubling intervals up to
+// backoff_max. A probe that gets an answer brings the target back up.
+// Times are steady clock nanoseconds, owned by the target's poller thread
+class TargetHealth {
+public:
+    enum class Action { Poll, Probe, Skip };
+
+    TargetHealth(int down_after, uint64_t backoff_min_ns, uint64_t backoff_max_ns)
+    : down_after_(down_after), backoff_min_(backoff_min_ns),
+      backoff_max_(std::max(backoff_max_ns, backoff_min_ns)) {}
+
+    // What to do with the target in a cycle starting at now
+    Action next(uint64_t now) const {
+        if (!down_) return Action::Poll;
+        return now >= next_probe_ ? Action::Probe : Action::Skip;
+    }
+    // Result of a poll or probe, reached means the agent answered (even with an error status)
+    void report(bool reached, uint64_t now) {
+        if (reached) {
+            failures_ = 0;
+            down_ = false;
+            backoff_ = 0;
+            return;
+        }
+        ++failures_;
+        if (down_) {
+            backoff_ = std::min(backoff_ * 2, backoff_max_);
+        } else if (down_after_ > 0 && failures_ >= down_after_) {
+            down_ = true;
+            backoff_ = backoff_min_;
+        } else {
+            return;
+        }
+        next_probe_ = now + backoff_;
+    }
+    bool up() const { return failures_ == 0; }
+    bool down() const { return down_; }
+    int failures() const { return failures_; }
+
+private:
+    int down_after_; // 0 never opens the breaker
+    uint64_t backoff_min_;
+    uint64_t backoff_max_;
+    int failures_ = 0;
+    bool down_ = false;
+    uint64_t backoff_ = 0;
+    uint64_t next_probe_ = 0;
+};
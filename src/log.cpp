@@ -0,0 +1,345 @@
+#include "log.hpp"
+#include "ring.hpp"
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+
+namespace logging {
+
+std::atomic<uint8_t> g_level{(uint8_t)Level::Warning};
+
+namespace {
+
+constexpr size_t kRingRecords = 512; // per thread, 128 KiB
+
+const char *const kLevelNames[] = {"DEBUG", "INFO", "WARNING", "ERROR"};
+const char *const kJsonLevels[] = {"debug", "info", "warning", "error"};
+
+// Producer side of one thread. Rings outlive their thread until the writer has drained them
+struct ThreadRing {
+    SpscRing<Record> ring{kRingRecords};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<bool> alive{true};
+};
+
+std::atomic<bool> g_json{false};
+std::atomic<uint64_t> g_rate_window{60ull * 1000000000ull};
+std::atomic<FILE *> g_out{nullptr};
+
+std::mutex g_rings_mutex;
+std::vector<std::unique_ptr<ThreadRing>> *g_rings = new std::vector<std::unique_ptr<ThreadRing>>; // never freed, threads may log during exit
+std::atomic<bool> g_running{false};
+std::atomic<bool> g_stop{false};
+std::thread g_writer;
+std::mutex g_write_mutex; // synchronous writes and the writer thread
+
+uint64_t now_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+struct RingHandle {
+    ThreadRing *ring = nullptr;
+    ~RingHandle() {
+        if (ring) ring->alive.store(false, std::memory_order_release);
+    }
+};
+
+ThreadRing &thread_ring() {
+    thread_local RingHandle handle;
+    if (!handle.ring) {
+        std::lock_guard<std::mutex> lock(g_rings_mutex);
+        g_rings->emplace_back(new ThreadRing);
+        handle.ring = g_rings->back().get();
+    }
+    return *handle.ring;
+}
+
+// Last write of each (call site, key) and how many were suppressed since, per thread
+struct Limit {
+    uint64_t last_ts;
+    uint32_t suppressed;
+};
+
+FILE *output() {
+    FILE *f = g_out.load(std::memory_order_relaxed);
+    return f ? f : stderr;
+}
+
+void write_lines(const std::vector<Record> &records) {
+    bool json = g_json.load(std::memory_order_relaxed);
+    std::string out;
+    for (const Record &r : records) {
+        out += format(r, json);
+        out += '\n';
+    }
+    if (out.empty()) return;
+    FILE *f = output();
+    fwrite(out.data(), 1, out.size(), f);
+    fflush(f);
+}
+
+Record dropped_record(uint64_t n) {
+    static const char fmt[] = "{} log messages dropped, the log ring was full";
+    Record r;
+    r.ts = now_ns();
+    r.fmt = fmt;
+    r.suppressed = 0;
+    r.used = 0;
+    r.key_len = 0;
+    r.level = Level::Warning;
+    detail::encode(r, n);
+    return r;
+}
+
+// Moves everything queued so far to the output in time order
+void drain() {
+    std::vector<Record> records;
+    Record r;
+    {
+        std::lock_guard<std::mutex> lock(g_rings_mutex);
+        auto &rings = *g_rings;
+        for (size_t i = 0; i < rings.size();) {
+            ThreadRing &tr = *rings[i];
+            bool alive = tr.alive.load(std::memory_order_acquire);
+            while (tr.ring.pop(r)) records.push_back(r);
+            if (uint64_t n = tr.dropped.exchange(0, std::memory_order_relaxed)) records.push_back(dropped_record(n));
+            if (!alive) {
+                rings.erase(rings.begin() + i); // its thread is gone and it is empty
+            } else {
+                ++i;
+            }
+        }
+    }
+    std::stable_sort(records.begin(), records.end(), [](const Record &a, const Record &b) { return a.ts < b.ts; });
+    std::lock_guard<std::mutex> lock(g_write_mutex);
+    write_lines(records);
+}
+
+void writer_loop() {
+    while (!g_stop.load(std::memory_order_acquire)) {
+        drain();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    drain();
+}
+
+// Stops the writer at exit when main returned early
+struct ExitGuard {
+    ~ExitGuard() { stop(); }
+} g_exit_guard;
+
+void append_json_string(std::string &out, std::string_view s) {
+    out += '"';
+    for (char c : s) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if ((unsigned char)c < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)(unsigned char)c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+// Appends the next argument of a record, returns false when there is none
+bool append_arg(std::string &out, const Record &r, size_t &pos) {
+    if (pos >= r.used) return false;
+    char tag = r.data[pos++];
+    char buf[32];
+    switch (tag) {
+        case detail::Int: {
+            int64_t v;
+            memcpy(&v, r.data + pos, 8);
+            pos += 8;
+            snprintf(buf, sizeof(buf), "%lld", (long long)v);
+            out += buf;
+            return true;
+        }
+        case detail::Uint: {
+            uint64_t v;
+            memcpy(&v, r.data + pos, 8);
+            pos += 8;
+            snprintf(buf, sizeof(buf), "%llu", (unsigned long long)v);
+            out += buf;
+            return true;
+        }
+        case detail::Double: {
+            double v;
+            memcpy(&v, r.data + pos, 8);
+            pos += 8;
+            snprintf(buf, sizeof(buf), "%g", v);
+            out += buf;
+            return true;
+        }
+        case detail::Bool:
+            out += r.data[pos++] ? "true" : "false";
+            return true;
+        case detail::Char:
+            out += r.data[pos++];
+            return true;
+        case detail::String: {
+            uint16_t n;
+            memcpy(&n, r.data + pos, 2);
+            out.append(r.data + pos + 2, n);
+            pos += 2 + n;
+            return true;
+        }
+        default:
+            pos = r.used;
+            return false;
+    }
+}
+
+std::string message(const Record &r) {
+    std::string out;
+    size_t pos = r.key_len;
+    for (const char *p = r.fmt; *p; ++p) {
+        if (p[0] == '{' && p[1] == '}') {
+            append_arg(out, r, pos);
+            ++p;
+        } else if ((p[0] == '{' && p[1] == '{') || (p[0] == '}' && p[1] == '}')) {
+            out += *p++;
+        } else {
+            out += *p;
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+void set_level(Level level) {
+    g_level.store((uint8_t)level, std::memory_order_relaxed);
+}
+
+bool parse_level(const std::string &name, Level &level) {
+    static const char *const names[] = {"debug", "info", "warning", "error", "off"};
+    for (uint8_t i = 0; i < 5; ++i)
+        if (name == names[i]) {
+            level = (Level)i;
+            return true;
+        }
+    return false;
+}
+
+void set_json(bool json) {
+    g_json.store(json, std::memory_order_relaxed);
+}
+
+void set_rate_window(uint64_t ns) {
+    g_rate_window.store(ns, std::memory_order_relaxed);
+}
+
+void set_output(FILE *out) {
+    g_out.store(out, std::memory_order_relaxed);
+}
+
+void start() {
+    if (g_running.exchange(true)) return;
+    g_stop.store(false, std::memory_order_relaxed);
+    g_writer = std::thread(writer_loop);
+}
+
+void stop() {
+    if (!g_running.load()) return;
+    g_stop.store(true, std::memory_order_release);
+    g_writer.join();
+    g_running.store(false);
+    drain(); // anything pushed while the writer was finishing
+}
+
+namespace detail {
+
+Record &begin(Level level, const char *fmt, std::string_view key) {
+    thread_local Record r;
+    r.ts = now_ns();
+    r.fmt = fmt;
+    r.suppressed = 0;
+    r.level = level;
+    r.key_len = (uint8_t)std::min(key.size(), Record::kMaxKey);
+    memcpy(r.data, key.data(), r.key_len);
+    r.used = r.key_len;
+    return r;
+}
+
+bool admit(Record &r, std::string_view key) {
+    // Call site by its format string, FNV-1a over the whole key
+    uint64_t id = 14695981039346656037ull ^ (uint64_t)(uintptr_t)r.fmt;
+    for (char c : key) id = (id ^ (unsigned char)c) * 1099511628211ull;
+    thread_local std::unordered_map<uint64_t, Limit> limits;
+    auto it = limits.find(id);
+    if (it == limits.end()) {
+        limits.emplace(id, Limit{r.ts, 0});
+        return true;
+    }
+    Limit &l = it->second;
+    if (r.ts - l.last_ts < g_rate_window.load(std::memory_order_relaxed)) {
+        ++l.suppressed;
+        return false;
+    }
+    r.suppressed = l.suppressed;
+    l = Limit{r.ts, 0};
+    return true;
+}
+
+void commit(Record &r) {
+    if (!g_running.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(g_write_mutex);
+        write_lines({r});
+        return;
+    }
+    ThreadRing &tr = thread_ring();
+    if (!tr.ring.push(r)) tr.dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace detail
+
+std::string format(const Record &r, bool json) {
+    time_t secs = (time_t)(r.ts / 1000000000ull);
+    struct tm tm;
+    gmtime_r(&secs, &tm);
+    char stamp[80];
+    snprintf(stamp, sizeof(stamp), "%04d-%02d-%02dT%02d:%02d:%02d.%03uZ", tm.tm_year + 1900, tm.tm_mon + 1,
+             tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, (unsigned)(r.ts / 1000000ull % 1000));
+    size_t level = std::min<size_t>((size_t)r.level, 3);
+    std::string out;
+    if (json) {
+        out = "{\"ts\":\"";
+        out += stamp;
+        out += "\",\"level\":\"";
+        out += kJsonLevels[level];
+        out += "\",\"msg\":";
+        append_json_string(out, message(r));
+        if (r.key_len) {
+            out += ",\"key\":";
+            append_json_string(out, std::string_view(r.data, r.key_len));
+        }
+        if (r.suppressed) out += ",\"suppressed\":" + std::to_string(r.suppressed);
+        out += '}';
+    } else {
+        out = stamp;
+        out += " [";
+        out += kLevelNames[level];
+        out += "] ";
+        out += message(r);
+        if (r.suppressed) out += " (" + std::to_string(r.suppressed) + " similar messages suppressed)";
+    }
+    return out;
+}
+
+} // namespace logging
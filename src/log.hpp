@@ -0,0 +1,145 @@
+#pragma once
+#include <atomic>
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+// Asynchronous structured logger. A call site costs one relaxed load when its
+// level is disabled, the arguments are not even evaluated. Enabled messages
+// copy the format string pointer and the raw argument values into a record on
+// the calling thread's lock-free ring; formatting and writing happen on a
+// background thread. Output is text or JSON lines on stderr. Messages with a
+// key (an OID, a target) are rate limited per call site and key.
+//
+//   LOG_WARNING("Queue for {} full, dropping oldest payload", endpoint);
+//   LOG_LIMITED(Warning, oid, "The OID {} is not of a numeric type", oid);
+//
+// Before start() and after stop() messages are written synchronously
+namespace logging {
+
+enum class Level : uint8_t { Debug, Info, Warning, Error, Off };
+
+extern std::atomic<uint8_t> g_level;
+
+inline bool enabled(Level level) {
+    return (uint8_t)level >= g_level.load(std::memory_order_relaxed);
+}
+
+void set_level(Level level);
+// "debug", "info", "warning", "error" or "off"
+bool parse_level(const std::string &name, Level &level);
+void set_json(bool json);
+// Keyed messages are written at most once per window, the next one tells how many were suppressed
+void set_rate_window(uint64_t ns);
+// Defaults to stderr, mainly for tests
+void set_output(FILE *out);
+
+// Starts the background writer, stop() drains every ring and joins it
+void start();
+void stop();
+
+// One message as it travels through a ring: arguments are stored as a type
+// tag followed by the value, strings by length and bytes (truncated to fit)
+struct Record {
+    static constexpr size_t kSize = 256;
+    uint64_t ts;
+    const char *fmt;
+    uint32_t suppressed;
+    uint16_t used;
+    uint8_t key_len;
+    Level level;
+    char data[kSize - 24];
+    // Longer keys are cut for output (the rate limit uses the whole key), the rest is for arguments
+    static constexpr size_t kMaxKey = sizeof(data) / 4;
+};
+static_assert(sizeof(Record) == Record::kSize, "records are one fixed size");
+
+namespace detail {
+
+enum Tag : char { Int = 'i', Uint = 'u', Double = 'd', Bool = 'b', Char = 'c', String = 's' };
+
+inline void put(Record &r, Tag tag, const void *v, size_t n) {
+    if (r.used + 1u + n > sizeof(r.data)) {
+        r.used = sizeof(r.data); // later arguments are dropped as well
+        return;
+    }
+    r.data[r.used] = tag;
+    memcpy(r.data + r.used + 1, v, n);
+    r.used += (uint16_t)(1 + n);
+}
+
+inline void put_string(Record &r, std::string_view s) {
+    if (r.used + 3u > sizeof(r.data)) {
+        r.used = sizeof(r.data);
+        return;
+    }
+    uint16_t n = (uint16_t)std::min(s.size(), sizeof(r.data) - r.used - 3);
+    r.data[r.used] = String;
+    memcpy(r.data + r.used + 1, &n, 2);
+    memcpy(r.data + r.used + 3, s.data(), n);
+    r.used += (uint16_t)(3 + n);
+}
+
+template <class T>
+void encode(Record &r, const T &v) {
+    if constexpr (std::is_same_v<T, bool>) {
+        put(r, Bool, &v, 1);
+    } else if constexpr (std::is_same_v<T, char>) {
+        put(r, Char, &v, 1);
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+        int64_t x = v;
+        put(r, Int, &x, sizeof(x));
+    } else if constexpr (std::is_integral_v<T>) {
+        uint64_t x = v;
+        put(r, Uint, &x, sizeof(x));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        double x = v;
+        put(r, Double, &x, sizeof(x));
+    } else if constexpr (std::is_pointer_v<T>) {
+        put_string(r, v ? std::string_view(v) : std::string_view("(null)"));
+    } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+        put_string(r, v);
+    } else {
+        static_assert(std::is_integral_v<T>, "unsupported log argument type");
+    }
+}
+
+Record &begin(Level level, const char *fmt, std::string_view key);
+// Rate limit check for keyed messages, false when this one is suppressed
+bool admit(Record &r, std::string_view key);
+void commit(Record &r);
+
+} // namespace detail
+
+template <class... Args>
+void write(Level level, const char *fmt, const Args &...args) {
+    Record &r = detail::begin(level, fmt, std::string_view());
+    (detail::encode(r, args), ...);
+    detail::commit(r);
+}
+
+template <class... Args>
+void write_limited(Level level, std::string_view key, const char *fmt, const Args &...args) {
+    Record &r = detail::begin(level, fmt, key);
+    if (!detail::admit(r, key)) return;
+    (detail::encode(r, args), ...);
+    detail::commit(r);
+}
+
+// Formats a record as one line ({} placeholders, {{ and }} escape braces)
+std::string format(const Record &r, bool json);
+
+} // namespace logging
+
+#define LOG_AT(level, ...) \
+    do { if (logging::enabled(logging::Level::level)) logging::write(logging::Level::level, __VA_ARGS__); } while (0)
+#define LOG_DEBUG(...) LOG_AT(Debug, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(Info, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(Warning, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(Error, __VA_ARGS__)
+#define LOG_LIMITED(level, key, ...) \
+    do { if (logging::enabled(logging::Level::level)) logging::write_limited(logging::Level::level, key, __VA_ARGS__); } while (0)
@@ -4,76 +4,521 @@
 #include "snmp.hpp"
 #include "otel.hpp"
 #include "utils.hpp"
+#include "spool.hpp"
+#include "prometheus.hpp"
+#include "ring.hpp"
+#include "tsdb.hpp"
+#include "capture.hpp"
+#include "snapshot.hpp"
+#include "config.hpp"
+#include "profiles.hpp"
+#include "telemetry.hpp"
+#include "health.hpp"
+#include "log.hpp"
+#include "mib_index.hpp"
 #include <thread>
 #include <chrono>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <fstream>
 
 
-volatile bool g_run = true;
+std::atomic<bool> g_run{true};
+std::atomic<bool> g_reload{false};
 void sigint_handler(int) { g_run = false; }
+void sighup_handler(int) { g_reload = true; }
 
 void usage() {
-    std::cerr << "Usage: snmp2otel -t target [-C community] -o oids_file -e endpoint [-i interval] [-r retries] [-T timeout] [-p port] [-v] [-m] mapping_file\n";
+    std::cerr << "Usage: snmp2otel -t target[,target...] [-C community] -o oids_file|--profile name[,name] -e endpoint[#gzip] [-e ...] [-i interval] [-r retries] [-T timeout] [-p port] [-v] [-m] mapping_file\n"
+                 "       [--spool-dir dir] [--spool-max-mb n] [--spool-max-age s] [--spool-sync-ms ms]\n"
+                 "       [--batch-points n] [--batch-bytes n] [--batch-delay-ms ms] [--max-request-bytes n]\n"
+                 "       [--resource-interval cycles] [--queue-size n] [--poll-threads n]\n"
+                 "       [--prometheus-port port] [--cache-mb n --cache-port port]\n"
+                 "       [--record file] [--replay file [--replay-rate x]]\n"
+                 "       [--snapshot file] [--reload-interval s]\n"
+                 "       [--profile auto|name[,name...]] [--profile-rows n]\n"
+                 "       [--self-metrics-interval s] [--self-metrics-file file]\n"
+                 "       [--down-after failures] [--probe-max-s s]\n"
+                 "       [--log-level debug|info|warning|error|off] [--log-json] [--no-mibs] [--mib-index file]\n"
+                 "       snmp2otel -o oids_file [-m mapping_file] --compile-snapshot file\n"
+                 "       snmp2otel --mib-dir dir[:dir...] --compile-mib-index file\n";
 }
 
 int main(int argc, char **argv) {
-    std::string target;
+    std::vector<std::string> targets;
     std::string community = "public";
     std::string oids_file;
-    std::string endpoint;
+    std::vector<std::string> endpoints;
     int interval = 10;
     int retries = 2;
     int timeout_ms = 1000;
     int port = 161;
     bool verbose = false;
     std::string mapping_file;
+    SpoolOptions spool;
+    int queue_size = 64;
+    int prometheus_port = 0;
+    BatchLimits limits;
+    int resource_interval = 60;
+    int poll_threads = 1;
+    size_t cache_mb = 0;
+    int cache_port = 0;
+    std::string record_file;
+    std::string replay_file;
+    double replay_rate = 0; // 0 as fast as possible, 1 original speed
+    std::string snapshot_file;
+    std::string compile_snapshot;
+    int reload_interval = 5;
+    std::vector<std::string> profile_names;
+    int profile_rows = kDefaultProfileRows;
+    int self_metrics_interval = 0;
+    std::string self_metrics_file;
+    int down_after = 3;
+    int probe_max_s = 300;
+    std::string log_level;
+    bool log_json = false;
+    bool no_mibs = false;
+    std::string mib_index_file;
+    std::string compile_mib_index;
+    std::vector<std::string> mib_dirs;
 
+    enum { OPT_SPOOL_DIR = 256, OPT_SPOOL_MAX_MB, OPT_SPOOL_MAX_AGE, OPT_SPOOL_SYNC_MS,
+           OPT_BATCH_POINTS, OPT_BATCH_BYTES, OPT_BATCH_DELAY, OPT_MAX_REQUEST, OPT_RESOURCE_INTERVAL,
+           OPT_QUEUE_SIZE, OPT_PROMETHEUS_PORT, OPT_POLL_THREADS,
+           OPT_CACHE_MB, OPT_CACHE_PORT, OPT_RECORD, OPT_REPLAY, OPT_REPLAY_RATE,
+           OPT_SNAPSHOT, OPT_COMPILE_SNAPSHOT, OPT_RELOAD_INTERVAL,
+           OPT_PROFILE, OPT_PROFILE_ROWS, OPT_SELF_METRICS_INTERVAL, OPT_SELF_METRICS_FILE,
+           OPT_DOWN_AFTER, OPT_PROBE_MAX, OPT_LOG_LEVEL, OPT_LOG_JSON, OPT_NO_MIBS,
+           OPT_MIB_INDEX, OPT_MIB_DIR, OPT_COMPILE_MIB_INDEX };
+    static const struct option long_opts[] = {
+        {"spool-dir", required_argument, nullptr, OPT_SPOOL_DIR},
+        {"spool-max-mb", required_argument, nullptr, OPT_SPOOL_MAX_MB},
+        {"spool-max-age", required_argument, nullptr, OPT_SPOOL_MAX_AGE},
+        {"spool-sync-ms", required_argument, nullptr, OPT_SPOOL_SYNC_MS},
+        {"batch-points", required_argument, nullptr, OPT_BATCH_POINTS},
+        {"batch-bytes", required_argument, nullptr, OPT_BATCH_BYTES},
+        {"batch-delay-ms", required_argument, nullptr, OPT_BATCH_DELAY},
+        {"max-request-bytes", required_argument, nullptr, OPT_MAX_REQUEST},
+        {"resource-interval", required_argument, nullptr, OPT_RESOURCE_INTERVAL},
+        {"queue-size", required_argument, nullptr, OPT_QUEUE_SIZE},
+        {"prometheus-port", required_argument, nullptr, OPT_PROMETHEUS_PORT},
+        {"poll-threads", required_argument, nullptr, OPT_POLL_THREADS},
+        {"cache-mb", required_argument, nullptr, OPT_CACHE_MB},
+        {"cache-port", required_argument, nullptr, OPT_CACHE_PORT},
+        {"record", required_argument, nullptr, OPT_RECORD},
+        {"replay", required_argument, nullptr, OPT_REPLAY},
+        {"replay-rate", required_argument, nullptr, OPT_REPLAY_RATE},
+        {"snapshot", required_argument, nullptr, OPT_SNAPSHOT},
+        {"compile-snapshot", required_argument, nullptr, OPT_COMPILE_SNAPSHOT},
+        {"reload-interval", required_argument, nullptr, OPT_RELOAD_INTERVAL},
+        {"profile", required_argument, nullptr, OPT_PROFILE},
+        {"profile-rows", required_argument, nullptr, OPT_PROFILE_ROWS},
+        {"self-metrics-interval", required_argument, nullptr, OPT_SELF_METRICS_INTERVAL},
+        {"self-metrics-file", required_argument, nullptr, OPT_SELF_METRICS_FILE},
+        {"down-after", required_argument, nullptr, OPT_DOWN_AFTER},
+        {"probe-max-s", required_argument, nullptr, OPT_PROBE_MAX},
+        {"log-level", required_argument, nullptr, OPT_LOG_LEVEL},
+        {"log-json", no_argument, nullptr, OPT_LOG_JSON},
+        {"no-mibs", no_argument, nullptr, OPT_NO_MIBS},
+        {"mib-index", required_argument, nullptr, OPT_MIB_INDEX},
+        {"mib-dir", required_argument, nullptr, OPT_MIB_DIR},
+        {"compile-mib-index", required_argument, nullptr, OPT_COMPILE_MIB_INDEX},
+        {nullptr, 0, nullptr, 0}
+    };
 
     int opt;
-    while ((opt = getopt(argc, argv, "t:C:o:e:i:r:T:p:m:vh")) != -1) {
+    while ((opt = getopt_long(argc, argv, "t:C:o:e:i:r:T:p:m:vh", long_opts, nullptr)) != -1) {
         switch (opt) {
-            case 't': target = optarg; break;
+            case 't': for (auto &t : split_list(optarg, ',')) targets.push_back(t); break;
             case 'C': community = optarg; break;
             case 'o': oids_file = optarg; break;
-            case 'e': endpoint = optarg; break;
+            case 'e': endpoints.push_back(optarg); break;
             case 'i': interval = atoi(optarg); break;
             case 'r': retries = atoi(optarg); break;
             case 'T': timeout_ms = atoi(optarg); break;
             case 'p': port = atoi(optarg); break;
             case 'm': mapping_file = optarg; break;
             case 'v': verbose = true; break;
+            case OPT_SPOOL_DIR: spool.dir = optarg; break;
+            case OPT_SPOOL_MAX_MB: spool.max_bytes = strtoull(optarg, nullptr, 10) << 20; break;
+            case OPT_SPOOL_MAX_AGE: spool.max_age_s = strtoull(optarg, nullptr, 10); break;
+            case OPT_SPOOL_SYNC_MS: spool.sync_ms = atoi(optarg); break;
+            case OPT_BATCH_POINTS: limits.max_points = strtoul(optarg, nullptr, 10); break;
+            case OPT_BATCH_BYTES: limits.max_bytes = strtoul(optarg, nullptr, 10); break;
+            case OPT_BATCH_DELAY: limits.max_delay_ms = atoi(optarg); break;
+            case OPT_MAX_REQUEST: limits.max_request_bytes = strtoul(optarg, nullptr, 10); break;
+            case OPT_RESOURCE_INTERVAL: resource_interval = atoi(optarg); break;
+            case OPT_QUEUE_SIZE: queue_size = atoi(optarg); break;
+            case OPT_PROMETHEUS_PORT: prometheus_port = atoi(optarg); break;
+            case OPT_POLL_THREADS: poll_threads = atoi(optarg); break;
+            case OPT_CACHE_MB: cache_mb = strtoul(optarg, nullptr, 10); break;
+            case OPT_CACHE_PORT: cache_port = atoi(optarg); break;
+            case OPT_RECORD: record_file = optarg; break;
+            case OPT_REPLAY: replay_file = optarg; break;
+            case OPT_REPLAY_RATE: replay_rate = atof(optarg); break;
+            case OPT_SNAPSHOT: snapshot_file = optarg; break;
+            case OPT_COMPILE_SNAPSHOT: compile_snapshot = optarg; break;
+            case OPT_RELOAD_INTERVAL: reload_interval = atoi(optarg); break;
+            case OPT_PROFILE: for (auto &p : split_list(optarg, ',')) profile_names.push_back(p); break;
+            case OPT_PROFILE_ROWS: profile_rows = atoi(optarg); break;
+            case OPT_SELF_METRICS_INTERVAL: self_metrics_interval = atoi(optarg); break;
+            case OPT_SELF_METRICS_FILE: self_metrics_file = optarg; break;
+            case OPT_DOWN_AFTER: down_after = atoi(optarg); break;
+            case OPT_PROBE_MAX: probe_max_s = atoi(optarg); break;
+            case OPT_LOG_LEVEL: log_level = optarg; break;
+            case OPT_LOG_JSON: log_json = true; break;
+            case OPT_NO_MIBS: no_mibs = true; break;
+            case OPT_MIB_INDEX: mib_index_file = optarg; break;
+            case OPT_MIB_DIR: for (auto &d : split_list(optarg, ':')) mib_dirs.push_back(d); break;
+            case OPT_COMPILE_MIB_INDEX: compile_mib_index = optarg; break;
             default: usage(); return 1;
         }
     }
-    if (target.empty() || oids_file.empty() || endpoint.empty()) {
+    // -v is short for --log-level debug
+    logging::Level level = verbose ? logging::Level::Debug : logging::Level::Warning;
+    if (!log_level.empty() && !logging::parse_level(log_level, level)) {
+        usage(); return 1;
+    }
+    logging::set_level(level);
+    logging::set_json(log_json);
+    logging::start();
+    // Symbolic OIDs otherwise load the MIBs on first use
+    set_mib_loading(!no_mibs);
+    if (!compile_mib_index.empty()) {
+        if (mib_dirs.empty()) { usage(); return 1; }
+        return MibIndex::compile(compile_mib_index, mib_dirs) ? 0 : 1;
+    }
+    // Symbolic OIDs are looked up in the index first, also when compiling a snapshot
+    std::shared_ptr<MibIndex> mib_index;
+    if (!mib_index_file.empty()) {
+        mib_index = std::make_shared<MibIndex>();
+        if (!mib_index->open(mib_index_file)) return 1;
+        set_mib_index(mib_index);
+    }
+    if (!compile_snapshot.empty()) {
+        if (oids_file.empty()) { usage(); return 1; }
+        return ConfigSnapshot::compile(compile_snapshot, oids_file, mapping_file) ? 0 : 1;
+    }
+    // Replay feeds a capture through the pipeline instead of polling devices
+    bool replay = !replay_file.empty();
+    if (replay) targets.clear();
+    if ((!replay && (targets.empty() || (oids_file.empty() && profile_names.empty()))) || endpoints.empty()) {
         usage(); return 1;
     }
     if (interval <= 0) interval = 10;
+    if (resource_interval <= 0) resource_interval = 60;
+    if (queue_size <= 0) queue_size = 64;
+    if (poll_threads <= 0) poll_threads = 1;
+    if (poll_threads > (int)targets.size()) poll_threads = std::max((int)targets.size(), 1);
     signal(SIGINT, sigint_handler);
+    signal(SIGHUP, sighup_handler);
+
+    // Built-in profiles by name for every target, "auto" adds the ones matching each device's sysObjectID
+    std::vector<const DeviceProfile *> named_profiles;
+    bool auto_profiles = false;
+    for (const auto &name : profile_names) {
+        if (name == "auto") {
+            auto_profiles = true;
+        } else if (const DeviceProfile *p = find_profile(name)) {
+            named_profiles.push_back(p);
+        } else {
+            size_t n;
+            const DeviceProfile *all = device_profiles(n);
+            std::string names;
+            for (size_t i = 0; i < n; ++i) names += std::string(" ") + all[i].name;
+            LOG_ERROR("Unknown profile {}, available:{}", name, names);
+            return 1;
+        }
+    }
+
+    // Slowly changing identity of the device, refreshed every resource_interval cycles
+    const std::string sys_name_oid = "1.3.6.1.2.1.1.5.0";
+    const std::string sys_object_id_oid = "1.3.6.1.2.1.1.2.0";
 
-    std::vector<std::string>  oids = load_oids_file(oids_file);
-    if (oids.empty()) {
-        if(verbose) std::cerr << "[ERROR] No OIDs loaded from " << oids_file << "\n";
+    struct Target {
+        uint32_t id;
+        std::unique_ptr<SNMPClient> client;
+        std::unique_ptr<TargetHealth> health;
+    };
+    std::vector<Target> polled;
+    ConfigSources sources;
+    sources.oids_file = oids_file;
+    sources.mapping_file = mapping_file;
+    sources.snapshot_file = snapshot_file;
+    sources.profile_rows = profile_rows;
+    sources.mib_index = mib_index;
+    for (const auto &target : targets) {
+        Target t;
+        t.client.reset(new SNMPClient(target, port, community, timeout_ms, retries));
+        // Unreachable targets are probed from one interval up to probe_max_s apart
+        t.health.reset(new TargetHealth(down_after, (uint64_t)interval * 1000000000ull,
+                                        (uint64_t)std::max(probe_max_s, interval) * 1000000000ull));
+        std::vector<const DeviceProfile *> selected = named_profiles;
+        if (auto_profiles) {
+            auto info = t.client->get_strings({sys_object_id_oid});
+            if (!info.count(sys_object_id_oid)) {
+                LOG_WARNING("No sysObjectID from {}, using the generic profiles", target);
+            }
+            for (const DeviceProfile *p : profiles_for_sys_object_id(info[sys_object_id_oid]))
+                if (std::find(selected.begin(), selected.end(), p) == selected.end()) selected.push_back(p);
+            if (logging::enabled(logging::Level::Info)) {
+                std::string names;
+                for (const DeviceProfile *p : selected) names += std::string(" ") + p->name;
+                LOG_INFO("Profiles of {}:{}", target, names);
+            }
+        }
+        sources.profiles.push_back(std::move(selected));
+        polled.push_back(std::move(t));
+    }
+    std::shared_ptr<Config> initial = load_config(sources, targets, nullptr);
+    if (!initial) return 1;
+    for (size_t i = 0; i < polled.size(); ++i) polled[i].id = initial->registry.intern_target(targets[i]);
+    std::unique_ptr<CaptureReader> capture_in;
+    std::vector<SeriesId> capture_ids; // capture series id -> SeriesId
+    if (replay) {
+        capture_in.reset(new CaptureReader(replay_file));
+        if (!capture_in->open() || !capture_intern(*capture_in, initial->registry, initial->mapping, capture_ids)) return 1;
+    }
+    // Version used by new cycles, replaced with an atomic swap on reload
+    std::shared_ptr<const Config> config = initial;
+    initial.reset();
+    std::unique_ptr<CaptureWriter> recorder;
+    if (!record_file.empty()) {
+        recorder.reset(new CaptureWriter(record_file));
+        if (!recorder->open()) return 1;
+    }
+    OTELExporter exporter(endpoints, limits, queue_size);
+    if (!exporter.valid()) {
+        LOG_ERROR("Invalid endpoint");
         return 1;
     }
-   
-    std::map<std::string, OIDInfo> mapping;
-    if(!mapping_file.empty()) {
-        mapping = load_oids_info(mapping_file, verbose);
+    if (!spool.dir.empty() && !exporter.enable_spool(spool)) return 1;
+
+    std::unique_ptr<PrometheusServer> prometheus;
+    if (prometheus_port > 0) {
+        prometheus.reset(new PrometheusServer(prometheus_port));
+        if (!prometheus->start()) return 1;
     }
-    
-    SNMPClient client(target, port, community, timeout_ms, retries, verbose);
-    OTELExporter exporter(endpoint, verbose);
 
-    while (g_run) {
-        if (verbose) std::cout << "[INFO] Starting poll cycle\n";
-        auto values = client.get(oids);
-        if (!values.empty()) {
-            exporter.export_gauge(values, mapping);
-        } else {
-            if (verbose) std::cout << "[WARNING] No values returned in this cycle\n";
+    // Recent samples kept compressed in memory, queryable over local HTTP
+    std::unique_ptr<TSDB> tsdb;
+    if (cache_mb > 0) {
+        tsdb.reset(new TSDB(cache_mb << 20));
+        tsdb->set_registry(std::shared_ptr<const SeriesRegistry>(config, &config->registry));
+        if (cache_port > 0 && !tsdb->start(cache_port)) return 1;
+    }
+
+    // Pipeline: every poller thread owns a slice of the targets and a small pool
+    // of batches. Filled batches travel to this (exporter) thread over one MPSC
+    // ring and come back to their poller over its SPSC free ring
+    constexpr size_t kBatchesPerPoller = 4;
+    struct Poller {
+        std::vector<Target *> targets;
+        std::vector<std::unique_ptr<SampleBatch>> pool;
+        std::unique_ptr<SpscRing<SampleBatch *>> free;
+        std::thread thread;
+    };
+    std::vector<Poller> pollers(poll_threads);
+    for (size_t i = 0; i < polled.size(); ++i) pollers[i % pollers.size()].targets.push_back(&polled[i]);
+    MpscRing<SampleBatch *> ready(pollers.size() * kBatchesPerPoller);
+    for (size_t p = 0; p < pollers.size(); ++p) {
+        size_t rows = 0;
+        for (Target *t : pollers[p].targets) rows += config->series[t->id].size() + 1; // + up
+        pollers[p].free.reset(new SpscRing<SampleBatch *>(kBatchesPerPoller));
+        for (size_t i = 0; i < kBatchesPerPoller; ++i) {
+            pollers[p].pool.emplace_back(new SampleBatch);
+            pollers[p].pool.back()->owner = (uint32_t)p;
+            pollers[p].pool.back()->reserve(rows);
+            pollers[p].free->push(pollers[p].pool.back().get());
+        }
+    }
+
+    std::atomic<int> active{(int)pollers.size()};
+    auto poll_loop = [&](Poller &p) {
+        auto next = std::chrono::steady_clock::now();
+        for (long cycle = 0; g_run; ++cycle) {
+            SampleBatch *batch;
+            while (!p.free->pop(batch) && g_run) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if (!g_run) break;
+            LOG_DEBUG("Starting poll cycle");
+            uint64_t cycle_start = telemetry::now_ns();
+            uint64_t pdus = 0;
+            batch->clear();
+            // The whole cycle works on the version current at its start
+            std::shared_ptr<const Config> cfg = std::atomic_load(&config);
+            batch->config = cfg;
+            for (Target *t : p.targets) {
+                // Down targets only get a probe now and then, up is exported either way
+                uint64_t now_ns = telemetry::now_ns();
+                TargetHealth::Action action = t->health->next(now_ns);
+                if (action != TargetHealth::Action::Poll) {
+                    if (action == TargetHealth::Action::Probe) {
+                        bool reached = t->client->probe();
+                        ++pdus;
+                        t->health->report(reached, now_ns);
+                        if (reached) LOG_INFO("Probe of {} answered, resuming polls", t->client->target());
+                        else LOG_DEBUG("Probe of {} failed", t->client->target());
+                    }
+                    if (t->health->down()) {
+                        batch->append(cfg->up[t->id], now_unix_nano(), SampleType::Gauge, 0);
+                        continue;
+                    }
+                }
+                if (cycle % resource_interval == 0) {
+                    auto info = t->client->get_strings({sys_name_oid, sys_object_id_oid});
+                    ++pdus;
+                    SampleBatch::Resource r{t->id, t->client->target(), {}};
+                    if (info.count(sys_name_oid)) r.attrs["sysName"] = info[sys_name_oid];
+                    if (info.count(sys_object_id_oid)) r.attrs["sysObjectID"] = info[sys_object_id_oid];
+                    batch->resources.push_back(std::move(r));
+                }
+                size_t before = batch->size();
+                t->client->get(cfg->series[t->id], cfg->registry, *batch);
+                ++pdus;
+                if (batch->size() == before) {
+                    LOG_LIMITED(Warning, t->client->target(), "No values returned from {} in this cycle", t->client->target());
+                }
+                bool reached = t->client->responded();
+                t->health->report(reached, telemetry::now_ns());
+                if (!reached && t->health->down())
+                    LOG_WARNING("{} is down after {} failed polls, probing it instead", t->client->target(), t->health->failures());
+                batch->append(cfg->up[t->id], now_unix_nano(), SampleType::Gauge, reached ? 1 : 0);
+            }
+            telemetry::add(telemetry::PollCycles);
+            telemetry::record(telemetry::PdusPerCycle, pdus);
+            telemetry::record(telemetry::PollCycleNs, telemetry::now_ns() - cycle_start);
+            // The ring holds every batch of the pool, the push only waits for a slot claim race
+            while (!ready.push(batch)) std::this_thread::yield();
+
+            next += std::chrono::seconds(interval);
+            auto now = std::chrono::steady_clock::now();
+            if (next < now) {
+                next = now; // overran the interval, do not try to catch up
+                telemetry::add(telemetry::MissedDeadlines);
+            }
+            while (g_run && now < next) {
+                std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(next - now, std::chrono::seconds(1)));
+                now = std::chrono::steady_clock::now();
+            }
+        }
+        --active;
+    };
+
+    // Replay stage standing in for the pollers, batches hold at most one response per target
+    size_t replayed = 0;
+    auto replay_loop = [&](Poller &p) {
+        const SeriesRegistry &registry = config->registry; // replay does not reload
+        CaptureReader::Record rec;
+        SampleBatch *batch = nullptr;
+        std::vector<uint64_t> seen(registry.target_count(), 0); // batch sequence a target was added in
+        uint64_t seq = 1;
+        uint64_t first_ts = 0;
+        auto start = std::chrono::steady_clock::now();
+        auto push = [&]() {
+            if (!batch) return;
+            while (!ready.push(batch)) std::this_thread::yield();
+            batch = nullptr;
+            ++seq;
+        };
+        while (g_run && capture_in->next(rec)) {
+            SeriesId first = capture_first(rec, capture_ids);
+            if (first == kInvalidSeries) continue;
+            if (replay_rate > 0) {
+                if (first_ts == 0) first_ts = rec.ts;
+                // Pollers interleave their records, one a little older than the first is due now
+                uint64_t offset = std::max(first_ts, rec.ts) - first_ts;
+                auto due = start + std::chrono::nanoseconds((int64_t)(offset / replay_rate));
+                if (due > std::chrono::steady_clock::now()) {
+                    push();
+                    while (g_run && std::chrono::steady_clock::now() < due)
+                        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+                            due - std::chrono::steady_clock::now(), std::chrono::seconds(1)));
+                }
+            }
+            uint32_t target = registry.target(first);
+            if (batch && (seen[target] == seq || batch->size() >= registry.size())) push();
+            if (!batch) {
+                while (!p.free->pop(batch) && g_run) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                if (!g_run) { batch = nullptr; break; }
+                batch->clear();
+                batch->config = config;
+            }
+            seen[target] = seq;
+            replayed += capture_append(rec, capture_ids, *batch);
         }
-        for (int i=0;i<interval && g_run;++i) std::this_thread::sleep_for(std::chrono::seconds(1));
+        push();
+        --active;
+    };
+    auto replay_start = std::chrono::steady_clock::now();
+    for (auto &p : pollers) p.thread = replay ? std::thread(replay_loop, std::ref(p)) : std::thread(poll_loop, std::ref(p));
+
+    // Configuration files are watched by polling their mtime, SIGHUP reloads at once
+    std::unique_ptr<ConfigWatcher> watcher;
+    if (!replay && reload_interval > 0) watcher.reset(new ConfigWatcher({oids_file, mapping_file, snapshot_file}));
+    auto next_check = std::chrono::steady_clock::now();
+    // Own pipeline metrics go out through the same exporter, as a separate resource and scope
+    auto next_self_metrics = std::chrono::steady_clock::now() + std::chrono::seconds(self_metrics_interval);
+    uint64_t exported_version = config->version;
+
+    // Exporter stage, runs until every poller has stopped and the ring is drained
+    for (;;) {
+        bool stopped = active == 0;
+        bool got = false;
+        SampleBatch *batch;
+        while (ready.pop(batch)) {
+            got = true;
+            const Config &cfg = *batch->config;
+            if (cfg.version > exported_version) {
+                // Metric names may have changed, drop everything rendered from the old version
+                exporter.invalidate_templates();
+                if (prometheus) prometheus->reset();
+                if (tsdb) tsdb->set_registry(std::shared_ptr<const SeriesRegistry>(batch->config, &cfg.registry));
+                exported_version = cfg.version;
+            }
+            for (const auto &r : batch->resources) exporter.set_resource_attributes(r.target, r.name, r.attrs);
+            exporter.export_batch(*batch, cfg.registry);
+            if (prometheus) prometheus->update(*batch, cfg.registry);
+            if (tsdb) tsdb->append(*batch);
+            if (recorder) recorder->write(*batch, cfg.registry);
+            batch->config.reset(); // lets an old version go once its last batch is done
+            pollers[batch->owner].free->push(batch);
+        }
+        bool due = watcher && std::chrono::steady_clock::now() >= next_check;
+        if (due) next_check = std::chrono::steady_clock::now() + std::chrono::seconds(reload_interval);
+        if (!stopped && !replay && (g_reload.exchange(false) || (due && watcher->changed()))) {
+            // Built beside the current version, pollers pick it up with their next cycle
+            if (watcher) watcher->loading();
+            std::shared_ptr<const Config> next = load_config(sources, targets, config.get());
+            if (next) {
+                std::atomic_store(&config, next);
+                if (watcher) watcher->loaded();
+                LOG_INFO("Configuration reloaded (version {}, {} series)", next->version, next->registry.size());
+            }
+        }
+        exporter.flush_if_due();
+        if (self_metrics_interval > 0 && std::chrono::steady_clock::now() >= next_self_metrics) {
+            next_self_metrics += std::chrono::seconds(self_metrics_interval);
+            exporter.export_resource_metrics(telemetry::render_resource_metrics());
+        }
+        if (got && prometheus) prometheus->publish();
+        if (stopped) break;
+        if (!got) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    for (auto &p : pollers) p.thread.join();
+    exporter.flush();
+    if (replay) {
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - replay_start).count();
+        LOG_INFO("Replayed {} samples in {} s ({} samples/s)", replayed, secs,
+                 (size_t)(replayed / (secs > 0 ? secs : 1)));
+    }
+    // Final totals for load tests and post mortems, same format as the exported scope
+    if (!self_metrics_file.empty()) {
+        std::ofstream out(self_metrics_file);
+        out << telemetry::render_resource_metrics() << "\n";
+        if (!out) LOG_ERROR("Cannot write {}", self_metrics_file);
     }
-    if (verbose) std::cout << "[INFO] Exiting\n";
+    LOG_INFO("Exiting");
+    logging::stop();
     return 0;
 }
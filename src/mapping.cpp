@@ -0,0 +1,154 @@
+#include "mapping.hpp"
+#include "series.hpp"
+#include "log.hpp"
+#include <algorithm>
+
+void OIDTrie::build(std::vector<Entry> entries) {
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const Entry &a, const Entry &b) { return a.arcs < b.arcs; });
+    nodes_.clear();
+    labels_.clear();
+    ext_nodes_ = nullptr;
+    nodes_.push_back(Node{0, 0, 0, 0, kNone, kNone});
+    build_node(0, entries, 0, entries.size(), 0);
+}
+
+// entries[lo, hi) are sorted and share their first depth arcs, which is the path of node
+void OIDTrie::build_node(uint32_t node, std::vector<Entry> &entries, size_t lo, size_t hi, size_t depth) {
+    // Entries ending here sort first
+    while (lo < hi && entries[lo].arcs.size() == depth) {
+        if (entries[lo].prefix) nodes_[node].prefix = entries[lo].value;
+        else nodes_[node].exact = entries[lo].value;
+        ++lo;
+    }
+    // Group the rest by their next arc, each group becomes one child
+    std::vector<std::pair<size_t, size_t>> groups;
+    for (size_t i = lo; i < hi;) {
+        size_t j = i + 1;
+        while (j < hi && entries[j].arcs[depth] == entries[i].arcs[depth]) ++j;
+        groups.emplace_back(i, j);
+        i = j;
+    }
+    uint32_t first = nodes_.size();
+    nodes_[node].first_child = first;
+    nodes_[node].child_count = groups.size();
+    nodes_.resize(first + groups.size());
+    for (size_t g = 0; g < groups.size(); ++g) {
+        const auto &a = entries[groups[g].first].arcs;
+        const auto &b = entries[groups[g].second - 1].arcs;
+        // In a sorted range the common prefix of all entries is the one of the first and last
+        size_t end = depth + 1;
+        while (end < a.size() && end < b.size() && a[end] == b[end]) ++end;
+        Node child{(uint32_t)labels_.size(), (uint32_t)(end - depth), 0, 0, kNone, kNone};
+        labels_.insert(labels_.end(), a.begin() + depth, a.begin() + end);
+        nodes_[first + g] = child;
+        build_node(first + g, entries, groups[g].first, groups[g].second, end);
+    }
+}
+
+void OIDTrie::attach(const Node *nodes, size_t node_count, const uint32_t *labels, size_t label_count) {
+    nodes_.clear();
+    labels_.clear();
+    ext_nodes_ = nodes;
+    ext_node_count_ = node_count;
+    ext_labels_ = labels;
+    ext_label_count_ = label_count;
+}
+
+uint32_t OIDTrie::find(const uint32_t *arcs, size_t len, size_t &matched) const {
+    uint32_t best = kNone;
+    matched = 0;
+    if (node_count() == 0) return best;
+    const Node *all = nodes();
+    const uint32_t *labels = this->labels();
+    const Node *node = &all[0];
+    size_t depth = 0;
+    for (;;) {
+        if (depth == len) return node->exact != kNone ? (matched = depth, node->exact) : best;
+        if (node->prefix != kNone) {
+            best = node->prefix;
+            matched = depth;
+        }
+        // Children are sorted by their first arc
+        const Node *lo = &all[node->first_child];
+        const Node *hi = lo + node->child_count;
+        uint32_t key = arcs[depth];
+        const Node *child = std::lower_bound(lo, hi, key,
+            [labels](const Node &n, uint32_t k) { return labels[n.label_off] < k; });
+        if (child == hi || labels[child->label_off] != key) return best;
+        if (depth + child->label_len > len) return best;
+        for (uint32_t i = 1; i < child->label_len; ++i)
+            if (labels[child->label_off + i] != arcs[depth + i]) return best;
+        depth += child->label_len;
+        node = child;
+    }
+}
+
+OIDMapping::OIDMapping(const std::map<std::string, OIDInfo> &mapping) {
+    std::vector<OIDTrie::Entry> entries;
+    entries.reserve(mapping.size());
+    std::vector<uint32_t> arcs;
+    for (const auto &kv : mapping) {
+        std::string key = kv.first;
+        bool prefix = kv.second.table;
+        if (key.size() >= 2 && key.compare(key.size() - 2, 2, ".*") == 0) {
+            key.resize(key.size() - 2);
+            prefix = true;
+        }
+        if (!parse_oid(key, arcs)) {
+            LOG_WARNING("Mapping key {} is not a numeric OID, ignored", kv.first);
+            continue;
+        }
+        add_rule(entries, arcs, prefix, kv.second.name, kv.second.unit, kv.second.type);
+    }
+    trie_.build(std::move(entries));
+}
+
+OIDMapping::OIDMapping(const std::vector<Source> &rules) {
+    std::vector<OIDTrie::Entry> entries;
+    entries.reserve(rules.size());
+    for (const auto &r : rules)
+        add_rule(entries, std::vector<uint32_t>(r.arcs, r.arcs + r.len), r.prefix, r.name, r.unit, r.type);
+    trie_.build(std::move(entries));
+}
+
+void OIDMapping::add_rule(std::vector<OIDTrie::Entry> &entries, std::vector<uint32_t> arcs, bool prefix,
+                          std::string_view name, std::string_view unit, std::string_view type) {
+    entries.push_back({std::move(arcs), prefix, (uint32_t)rules_.size()});
+    Rule r;
+    r.name_len = name.size();
+    r.name_off = add_string(name);
+    r.unit_len = unit.size();
+    r.unit_off = add_string(unit);
+    r.type_len = type.size();
+    r.type_off = add_string(type);
+    r.table = prefix;
+    rules_.push_back(r);
+}
+
+OIDMapping::OIDMapping(std::shared_ptr<const void> keepalive, const Rule *rules, size_t rule_count,
+                       const char *pool, size_t pool_len, const OIDTrie &trie)
+: keepalive_(std::move(keepalive)), ext_rules_(rules), ext_rule_count_(rule_count),
+  ext_pool_(pool), ext_pool_len_(pool_len), trie_(trie) {}
+
+uint32_t OIDMapping::add_string(std::string_view s) {
+    uint32_t off = pool_.size();
+    pool_.insert(pool_.end(), s.begin(), s.end());
+    return off;
+}
+
+bool OIDMapping::find(const uint32_t *arcs, size_t len, std::string &index, RuleView &rule) const {
+    index.clear();
+    size_t matched;
+    uint32_t id = trie_.find(arcs, len, matched);
+    if (id == OIDTrie::kNone) return fallback_ && fallback_->find(arcs, len, index, rule);
+    for (size_t i = matched; i < len; ++i) {
+        if (i > matched) index += '.';
+        index += std::to_string(arcs[i]);
+    }
+    const Rule &r = rules()[id];
+    const char *p = pool();
+    rule = RuleView{std::string_view(p + r.name_off, r.name_len), std::string_view(p + r.unit_off, r.unit_len),
+                    std::string_view(p + r.type_off, r.type_len), r.table != 0};
+    return true;
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <cstdint>
+#include "utils.hpp"
+
+// Compact radix trie over OID arcs. Nodes live in one flat array with the
+// children of a node stored next to each other, edges carry runs of arcs.
+// Every node can hold an exact value and a prefix (wildcard) value.
+// The arrays are either owned or borrowed from a mapped snapshot (attach)
+class OIDTrie {
+public:
+    static constexpr uint32_t kNone = UINT32_MAX;
+    struct Node {
+        uint32_t label_off;   // edge label in labels_
+        uint32_t label_len;
+        uint32_t first_child; // children are nodes_[first_child, first_child + child_count)
+        uint32_t child_count;
+        uint32_t exact;       // value for an OID equal to the path, or kNone
+        uint32_t prefix;      // value for OIDs strictly below the path, or kNone
+    };
+    struct Entry {
+        std::vector<uint32_t> arcs;
+        bool prefix;
+        uint32_t value;
+    };
+
+    // Builds the trie from entries in O(total arcs * log), later duplicates win
+    void build(std::vector<Entry> entries);
+    // Longest match: an exact entry for the whole OID wins, otherwise the deepest
+    // prefix entry; matched receives the number of arcs covered by it
+    uint32_t find(const uint32_t *arcs, size_t len, size_t &matched) const;
+    // Uses arrays owned by someone else, they must outlive the trie
+    void attach(const Node *nodes, size_t node_count, const uint32_t *labels, size_t label_count);
+    const Node *nodes() const { return ext_nodes_ ? ext_nodes_ : nodes_.data(); }
+    size_t node_count() const { return ext_nodes_ ? ext_node_count_ : nodes_.size(); }
+    const uint32_t *labels() const { return ext_nodes_ ? ext_labels_ : labels_.data(); }
+    size_t label_count() const { return ext_nodes_ ? ext_label_count_ : labels_.size(); }
+
+private:
+    std::vector<Node> nodes_; // nodes_[0] is the root
+    std::vector<uint32_t> labels_;
+    const Node *ext_nodes_ = nullptr;
+    size_t ext_node_count_ = 0;
+    const uint32_t *ext_labels_ = nullptr;
+    size_t ext_label_count_ = 0;
+    void build_node(uint32_t node, std::vector<Entry> &entries, size_t lo, size_t hi, size_t depth);
+};
+
+// OID to metric mapping with exact and wildcard rules.
+// "1.3.6.1.2.1.2.2.1.10.*" (or an entry with "table": true) matches every row of
+// the column, the arcs after the column become the datapoint's index attribute.
+// Rule metadata is kept in flat arrays so a snapshot can map it in place
+class OIDMapping {
+public:
+    // Rule as stored: strings are ranges of the string pool
+    struct Rule {
+        uint32_t name_off, name_len;
+        uint32_t unit_off, unit_len;
+        uint32_t type_off, type_len;
+        uint32_t table;
+    };
+    // Rule as seen by callers, views into the pool
+    struct RuleView {
+        std::string_view name;
+        std::string_view unit;
+        std::string_view type;
+        bool table;
+    };
+    // Rule with its OID already split into arcs (tables compiled into the binary)
+    struct Source {
+        const uint32_t *arcs;
+        size_t len;
+        bool prefix;
+        std::string_view name;
+        std::string_view unit;
+        std::string_view type;
+    };
+
+    OIDMapping() = default;
+    explicit OIDMapping(const std::map<std::string, OIDInfo> &mapping);
+    explicit OIDMapping(const std::vector<Source> &rules);
+    // Borrows arrays of a mapped snapshot, keepalive owns the mapping
+    OIDMapping(std::shared_ptr<const void> keepalive, const Rule *rules, size_t rule_count,
+               const char *pool, size_t pool_len, const OIDTrie &trie);
+    // Returns false when no rule matches; index gets the remaining arcs of a wildcard match
+    bool find(const uint32_t *arcs, size_t len, std::string &index, RuleView &rule) const;
+    // Rules consulted when none of this mapping matches (built-in profiles below the mapping file)
+    void set_fallback(std::shared_ptr<const OIDMapping> fallback) { fallback_ = std::move(fallback); }
+    size_t size() const { return keepalive_ ? ext_rule_count_ : rules_.size(); }
+
+    const Rule *rules() const { return keepalive_ ? ext_rules_ : rules_.data(); }
+    const char *pool() const { return keepalive_ ? ext_pool_ : pool_.data(); }
+    size_t pool_len() const { return keepalive_ ? ext_pool_len_ : pool_.size(); }
+    const OIDTrie &trie() const { return trie_; }
+
+private:
+    std::vector<Rule> rules_;
+    std::vector<char> pool_;
+    std::shared_ptr<const void> keepalive_;
+    const Rule *ext_rules_ = nullptr;
+    size_t ext_rule_count_ = 0;
+    const char *ext_pool_ = nullptr;
+    size_t ext_pool_len_ = 0;
+    OIDTrie trie_;
+    std::shared_ptr<const OIDMapping> fallback_;
+
+    uint32_t add_string(std::string_view s);
+    void add_rule(std::vector<OIDTrie::Entry> &entries, std::vector<uint32_t> arcs, bool prefix,
+                  std::string_view name, std::string_view unit, std::string_view type);
+};
@@ -0,0 +1,610 @@
+#include "mib_index.hpp"
+#include "log.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <cerrno>
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+const char kMagic[8] = {'S', '2', 'O', 'M', 'I', 'B', 'X', '1'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kEndian = 0x01020304;
+
+enum SectionId { kPool, kObjects, kArcs, kByName, kByOid, kSections };
+
+struct Section {
+    uint64_t off; // from the start of the file, 8 byte aligned
+    uint64_t count; // elements
+};
+
+bool write_all(int fd, const void *buf, size_t n) {
+    const char *p = static_cast<const char *>(buf);
+    while (n > 0) {
+        ssize_t w = ::write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += w; n -= (size_t)w;
+    }
+    return true;
+}
+
+struct Token {
+    std::string text;
+    bool string; // a quoted string, text without the quotes
+};
+
+// ASN.1 tokens of a module file, comments run from "--" to the end of the line or the next "--"
+std::vector<Token> tokenize(const std::string &s) {
+    std::vector<Token> out;
+    size_t i = 0, n = s.size();
+    while (i < n) {
+        char c = s[i];
+        if (isspace((unsigned char)c)) {
+            ++i;
+        } else if (c == '-' && i + 1 < n && s[i + 1] == '-') {
+            i += 2;
+            while (i < n && s[i] != '\n' && !(s[i] == '-' && i + 1 < n && s[i + 1] == '-')) ++i;
+            if (i < n && s[i] == '-') i += 2;
+        } else if (c == '"') {
+            std::string text;
+            for (++i; i < n; ++i) {
+                if (s[i] == '"') {
+                    if (i + 1 < n && s[i + 1] == '"') {
+                        text += '"';
+                        ++i;
+                        continue;
+                    }
+                    break;
+                }
+                text += s[i];
+            }
+            ++i;
+            out.push_back({std::move(text), true});
+        } else if (isalnum((unsigned char)c)) {
+            size_t j = i;
+            while (j < n && (isalnum((unsigned char)s[j]) || s[j] == '_' ||
+                             (s[j] == '-' && !(j + 1 < n && s[j + 1] == '-'))))
+                ++j;
+            out.push_back({s.substr(i, j - i), false});
+            i = j;
+        } else if (s.compare(i, 3, "::=") == 0) {
+            out.push_back({"::=", false});
+            i += 3;
+        } else {
+            out.push_back({std::string(1, c), false});
+            ++i;
+        }
+    }
+    return out;
+}
+
+// One OID-valued assignment: { parent sub... } or absolute { 1 3 6 ... }
+struct Definition {
+    std::string module;
+    std::string name;
+    std::string parent;
+    std::vector<uint32_t> sub;
+    std::string syntax;
+    std::string units;
+    std::string description;
+};
+
+// Imported names by module: module -> name -> module it comes from
+using Imports = std::map<std::string, std::map<std::string, std::string>>;
+
+const char *const kMacros[] = {"OBJECT-TYPE", "MODULE-IDENTITY", "OBJECT-IDENTITY", "NOTIFICATION-TYPE",
+                               "OBJECT-GROUP", "NOTIFICATION-GROUP", "MODULE-COMPLIANCE", "AGENT-CAPABILITIES"};
+const char *const kClauses[] = {"UNITS", "MAX-ACCESS", "ACCESS", "STATUS", "DESCRIPTION", "REFERENCE",
+                                "INDEX", "AUGMENTS", "DEFVAL", "::="};
+
+bool one_of(const std::string &s, const char *const *list, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        if (s == list[i]) return true;
+    return false;
+}
+
+bool is_number(const std::string &s) {
+    return !s.empty() && s.size() <= 10 && std::all_of(s.begin(), s.end(), [](char c) { return isdigit((unsigned char)c); });
+}
+
+std::string collapse_spaces(const std::string &s) {
+    std::string out;
+    for (char c : s) {
+        if (isspace((unsigned char)c)) {
+            if (!out.empty() && out.back() != ' ') out += ' ';
+        } else {
+            out += c;
+        }
+    }
+    if (!out.empty() && out.back() == ' ') out.pop_back();
+    return out;
+}
+
+// Collects the OID assignments of every module in one file. Type assignments
+// (textual conventions, SEQUENCEs) and macro definitions are skipped
+void parse_modules(const std::string &text, std::vector<Definition> &defs, Imports &imports) {
+    std::vector<Token> t = tokenize(text);
+    auto is = [&](size_t i, const char *s) { return i < t.size() && !t[i].string && t[i].text == s; };
+    std::string module;
+    size_t depth = 0;
+    for (size_t i = 0; i < t.size(); ++i) {
+        if (t[i].string) continue;
+        const std::string &w = t[i].text;
+        if (w == "{") {
+            ++depth;
+        } else if (w == "}") {
+            if (depth) --depth;
+        } else if (depth) {
+            continue;
+        } else if (is(i + 1, "DEFINITIONS")) {
+            module = w;
+        } else if (module.empty()) {
+            continue;
+        } else if (w == "MACRO") {
+            // Macro definitions of the SMI modules have a BEGIN ... END body of their own
+            while (i < t.size() && !is(i, "END")) ++i;
+        } else if (w == "END") {
+            module.clear();
+        } else if (w == "IMPORTS") {
+            std::vector<std::string> names;
+            for (++i; i < t.size() && !is(i, ";"); ++i) {
+                if (is(i, "FROM") && i + 1 < t.size()) {
+                    for (const auto &name : names) imports[module][name] = t[i + 1].text;
+                    names.clear();
+                    ++i;
+                } else if (!is(i, ",")) {
+                    names.push_back(t[i].text);
+                }
+            }
+        } else if (islower((unsigned char)w[0]) && i + 1 < t.size() && !t[i + 1].string) {
+            bool object_type = is(i + 1, "OBJECT-TYPE");
+            bool assignment = is(i + 1, "OBJECT") && is(i + 2, "IDENTIFIER") && is(i + 3, "::=");
+            if (!assignment && !one_of(t[i + 1].text, kMacros, std::size(kMacros))) continue;
+            Definition d;
+            d.module = module;
+            d.name = w;
+            // Clauses up to "::=", nested braces and parentheses (INDEX, DEFVAL, ranges) are skipped
+            size_t j = i + 2, inner = 0;
+            for (; j < t.size(); ++j) {
+                if (t[j].string) continue;
+                const std::string &c = t[j].text;
+                if (c == "{" || c == "(") {
+                    ++inner;
+                } else if (c == "}" || c == ")") {
+                    if (inner) --inner;
+                } else if (inner) {
+                    continue;
+                } else if (c == "::=") {
+                    break;
+                } else if (c == "SYNTAX" && object_type && d.syntax.empty()) {
+                    for (size_t k = j + 1; k < t.size() && !t[k].string; ++k) {
+                        const std::string &s = t[k].text;
+                        if (s == "{" || s == "(" || one_of(s, kClauses, std::size(kClauses))) break;
+                        if (!d.syntax.empty()) d.syntax += ' ';
+                        d.syntax += s;
+                    }
+                } else if (c == "UNITS" && object_type && j + 1 < t.size() && t[j + 1].string) {
+                    d.units = t[j + 1].text;
+                } else if (c == "DESCRIPTION" && d.description.empty() && j + 1 < t.size() && t[j + 1].string) {
+                    d.description = collapse_spaces(t[j + 1].text);
+                }
+            }
+            // Only { ... } values name an OID (TRAP-TYPE assigns a number)
+            if (!is(j + 1, "{")) {
+                i = j;
+                continue;
+            }
+            bool ok = true;
+            size_t k = j + 2;
+            for (bool first = true; k < t.size() && !is(k, "}"); ++k, first = false) {
+                const std::string &c = t[k].text;
+                if (is(k + 1, "(")) {
+                    // name(number)
+                    if (!is_number(k + 2 < t.size() ? t[k + 2].text : "") || !is(k + 3, ")")) {
+                        ok = false;
+                        break;
+                    }
+                    d.sub.push_back((uint32_t)std::stoul(t[k + 2].text));
+                    k += 3;
+                } else if (is_number(c)) {
+                    d.sub.push_back((uint32_t)std::stoul(c));
+                } else if (first && !t[k].string && islower((unsigned char)c[0])) {
+                    d.parent = c;
+                } else {
+                    ok = false;
+                    break;
+                }
+            }
+            i = k;
+            if (ok && (!d.parent.empty() || !d.sub.empty())) defs.push_back(std::move(d));
+        }
+    }
+}
+
+bool regular_file(const std::string &path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+// UNITS clauses are free text: the common ones map to UCUM, the rest become annotations
+std::string ucum_unit(std::string_view units, std::string_view syntax) {
+    static const std::pair<const char *, const char *> kKnown[] = {
+        {"seconds", "s"}, {"second", "s"}, {"milliseconds", "ms"}, {"microseconds", "us"},
+        {"centi-seconds", "cs"}, {"hundredths of a second", "cs"}, {"octets", "By"}, {"bytes", "By"},
+        {"bits", "bit"}, {"bits per second", "bit/s"}, {"bps", "bit/s"}, {"kbps", "kbit/s"},
+        {"kilobits per second", "kbit/s"}, {"mbps", "Mbit/s"}, {"percent", "%"}, {"%", "%"},
+        {"watts", "W"}, {"milliwatts", "mW"}, {"volts", "V"}, {"millivolts", "mV"}, {"amperes", "A"},
+        {"milliamperes", "mA"}, {"celsius", "Cel"}, {"degrees celsius", "Cel"},
+    };
+    if (units.empty()) return syntax == "TimeTicks" ? "cs" : "";
+    std::string lower(units);
+    for (char &c : lower) c = (char)tolower((unsigned char)c);
+    for (const auto &k : kKnown)
+        if (lower == k.first) return k.second;
+    return "{" + std::string(units) + "}";
+}
+
+// Monotonic base types (Counter is SMIv1); names that merely contain "Counter",
+// like CounterBasedGauge64, stay gauges
+bool counter_syntax(std::string_view syntax) {
+    std::string_view base = syntax.substr(0, syntax.find_first_of(" ("));
+    return base == "Counter32" || base == "Counter64" || base == "Counter" ||
+           base == "ZeroBasedCounter32" || base == "ZeroBasedCounter64";
+}
+
+} // namespace
+
+struct MibIndex::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;
+    Section sections[kSections];
+};
+
+bool MibIndex::compile(const std::string &path, const std::vector<std::string> &dirs) {
+    std::vector<Definition> defs;
+    Imports imports;
+    size_t files = 0;
+    for (const auto &dir : dirs) {
+        DIR *d = opendir(dir.c_str());
+        if (!d) {
+            LOG_ERROR("Cannot read MIB directory {}: {}", dir, strerror(errno));
+            return false;
+        }
+        std::vector<std::string> names;
+        while (struct dirent *e = readdir(d))
+            if (e->d_name[0] != '.') names.push_back(e->d_name);
+        closedir(d);
+        std::sort(names.begin(), names.end()); // the same index for the same files
+        for (const auto &name : names) {
+            std::string file = dir + "/" + name;
+            if (!regular_file(file)) continue;
+            std::ifstream in(file);
+            std::stringstream text;
+            text << in.rdbuf();
+            parse_modules(text.str(), defs, imports);
+            ++files;
+        }
+    }
+
+    // A module found twice (in two directories) keeps its first definitions
+    std::map<std::pair<std::string, std::string>, size_t> by_key;
+    std::unordered_map<std::string, size_t> by_name;
+    for (size_t i = 0; i < defs.size(); ++i) {
+        by_key.emplace(std::make_pair(defs[i].module, defs[i].name), i);
+        by_name.emplace(defs[i].name, i);
+    }
+    // A parent is looked up in its own module, then where it was imported from, then anywhere
+    auto lookup = [&](const std::string &module, const std::string &name) -> long {
+        auto it = by_key.find(std::make_pair(module, name));
+        if (it != by_key.end()) return (long)it->second;
+        auto m = imports.find(module);
+        if (m != imports.end()) {
+            auto from = m->second.find(name);
+            if (from != m->second.end() && (it = by_key.find(std::make_pair(from->second, name))) != by_key.end())
+                return (long)it->second;
+        }
+        auto any = by_name.find(name);
+        return any != by_name.end() ? (long)any->second : -1;
+    };
+    enum State : uint8_t { kNew, kVisiting, kResolved, kFailed };
+    std::vector<State> state(defs.size(), kNew);
+    std::vector<std::vector<uint32_t>> arcs(defs.size());
+    std::function<bool(size_t)> resolve = [&](size_t i) -> bool {
+        if (state[i] == kResolved || state[i] == kFailed || state[i] == kVisiting) return state[i] == kResolved;
+        state[i] = kVisiting;
+        const Definition &d = defs[i];
+        bool ok = true;
+        if (d.parent == "iso") {
+            arcs[i] = {1};
+        } else if (d.parent == "ccitt") {
+            arcs[i] = {0};
+        } else if (d.parent == "joint-iso-ccitt") {
+            arcs[i] = {2};
+        } else if (!d.parent.empty()) {
+            long p = lookup(d.module, d.parent);
+            ok = p >= 0 && resolve((size_t)p);
+            if (ok) arcs[i] = arcs[p];
+        }
+        arcs[i].insert(arcs[i].end(), d.sub.begin(), d.sub.end());
+        state[i] = ok ? kResolved : kFailed;
+        return ok;
+    };
+
+    std::string pool;
+    std::map<std::string, uint32_t> interned; // module names, syntaxes and units repeat a lot
+    auto add_string = [&](const std::string &s, bool intern) -> uint32_t {
+        if (intern) {
+            auto it = interned.find(s);
+            if (it != interned.end()) return it->second;
+        }
+        uint32_t off = pool.size();
+        pool += s;
+        if (intern) interned.emplace(s, off);
+        return off;
+    };
+    std::vector<Entry> entries;
+    std::vector<uint32_t> all_arcs;
+    size_t unresolved = 0;
+    for (size_t i = 0; i < defs.size(); ++i) {
+        const Definition &d = defs[i];
+        if (by_key[std::make_pair(d.module, d.name)] != i) continue;
+        if (!resolve(i)) {
+            ++unresolved;
+            continue;
+        }
+        Entry e;
+        e.module_off = add_string(d.module, true);
+        e.module_len = d.module.size();
+        e.name_off = add_string(d.name, false);
+        e.name_len = d.name.size();
+        e.arc_off = all_arcs.size();
+        e.arc_len = arcs[i].size();
+        all_arcs.insert(all_arcs.end(), arcs[i].begin(), arcs[i].end());
+        e.syntax_off = add_string(d.syntax, true);
+        e.syntax_len = d.syntax.size();
+        e.units_off = add_string(d.units, true);
+        e.units_len = d.units.size();
+        e.descr_off = add_string(d.description, false);
+        e.descr_len = d.description.size();
+        entries.push_back(e);
+    }
+    if (entries.empty()) {
+        LOG_ERROR("No MIB objects found in {} files", files);
+        return false;
+    }
+    if (unresolved) LOG_WARNING("{} MIB objects skipped, their parents are not defined in the given directories", unresolved);
+
+    // Lookup orders: by name (then module) and by OID
+    std::vector<uint32_t> sorted_names(entries.size()), sorted_oids(entries.size());
+    for (uint32_t i = 0; i < entries.size(); ++i) sorted_names[i] = sorted_oids[i] = i;
+    auto view = [&](uint32_t off, uint32_t len) { return std::string_view(pool.data() + off, len); };
+    std::sort(sorted_names.begin(), sorted_names.end(), [&](uint32_t a, uint32_t b) {
+        const Entry &x = entries[a], &y = entries[b];
+        return std::make_pair(view(x.name_off, x.name_len), view(x.module_off, x.module_len)) <
+               std::make_pair(view(y.name_off, y.name_len), view(y.module_off, y.module_len));
+    });
+    std::stable_sort(sorted_oids.begin(), sorted_oids.end(), [&](uint32_t a, uint32_t b) {
+        const Entry &x = entries[a], &y = entries[b];
+        return std::lexicographical_compare(all_arcs.begin() + x.arc_off, all_arcs.begin() + x.arc_off + x.arc_len,
+                                            all_arcs.begin() + y.arc_off, all_arcs.begin() + y.arc_off + y.arc_len);
+    });
+
+    Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kVersion;
+    h.endian = kEndian;
+    struct Blob { const void *data; size_t size; size_t count; };
+    Blob blobs[kSections] = {
+        {pool.data(), pool.size(), pool.size()},
+        {entries.data(), entries.size() * sizeof(Entry), entries.size()},
+        {all_arcs.data(), all_arcs.size() * sizeof(uint32_t), all_arcs.size()},
+        {sorted_names.data(), sorted_names.size() * sizeof(uint32_t), sorted_names.size()},
+        {sorted_oids.data(), sorted_oids.size() * sizeof(uint32_t), sorted_oids.size()},
+    };
+    uint64_t off = (sizeof(Header) + 7) & ~7ull;
+    for (int i = 0; i < kSections; ++i) {
+        h.sections[i] = Section{off, blobs[i].count};
+        off = (off + blobs[i].size + 7) & ~7ull;
+    }
+
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Cannot create MIB index {}: {}", tmp, strerror(errno));
+        return false;
+    }
+    static const char zeros[8] = {};
+    bool ok = write_all(fd, &h, sizeof(h));
+    uint64_t pos = sizeof(h);
+    for (int i = 0; i < kSections && ok; ++i) {
+        ok = write_all(fd, zeros, h.sections[i].off - pos) && write_all(fd, blobs[i].data, blobs[i].size);
+        pos = h.sections[i].off + blobs[i].size;
+    }
+    ok = ok && fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        LOG_ERROR("Cannot write MIB index {}: {}", path, strerror(errno));
+        unlink(tmp.c_str());
+        return false;
+    }
+    LOG_INFO("Compiled {} MIB objects from {} files into {}", entries.size(), files, path);
+    return true;
+}
+
+bool MibIndex::open(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR("Cannot open MIB index {}: {}", path, strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)) {
+        ::close(fd);
+        LOG_ERROR("MIB index {} is truncated", path);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        LOG_ERROR("Cannot map MIB index {}", path);
+        return false;
+    }
+    std::shared_ptr<const void> owner(map, [size](const void *p) { munmap(const_cast<void *>(p), size); });
+    const Header *h = static_cast<const Header *>(map);
+
+    if (memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 || h->version != kVersion || h->endian != kEndian) {
+        LOG_ERROR("{} is not a MIB index of this version", path);
+        return false;
+    }
+    static const size_t elem[kSections] = {1, sizeof(Entry), sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t)};
+    for (int i = 0; i < kSections; ++i) {
+        const Section &s = h->sections[i];
+        if (s.off % 8 != 0 || s.off > size || s.count > (size - s.off) / elem[i]) {
+            LOG_ERROR("MIB index {} is corrupt", path);
+            return false;
+        }
+    }
+    if (h->sections[kByName].count != h->sections[kObjects].count ||
+        h->sections[kByOid].count != h->sections[kObjects].count) {
+        LOG_ERROR("MIB index {} is corrupt", path);
+        return false;
+    }
+    // Entries and sort orders are used unchecked later, so they must stay in bounds
+    const Section *sec = h->sections;
+    const char *base = static_cast<const char *>(map);
+    auto in = [](uint64_t off, uint64_t len, uint64_t count) { return off + len <= count; };
+    bool valid = true;
+    const Entry *entries = reinterpret_cast<const Entry *>(base + sec[kObjects].off);
+    for (uint64_t i = 0; i < sec[kObjects].count && valid; ++i) {
+        const Entry &e = entries[i];
+        uint64_t pool = sec[kPool].count;
+        valid = in(e.module_off, e.module_len, pool) && in(e.name_off, e.name_len, pool) &&
+                in(e.syntax_off, e.syntax_len, pool) && in(e.units_off, e.units_len, pool) &&
+                in(e.descr_off, e.descr_len, pool) && in(e.arc_off, e.arc_len, sec[kArcs].count);
+    }
+    for (int idx : {kByName, kByOid}) {
+        const uint32_t *order = reinterpret_cast<const uint32_t *>(base + sec[idx].off);
+        for (uint64_t i = 0; i < sec[idx].count && valid; ++i) valid = order[i] < sec[kObjects].count;
+    }
+    if (!valid) {
+        LOG_ERROR("MIB index {} is corrupt", path);
+        return false;
+    }
+    map_ = std::move(owner);
+    hdr_ = h;
+    base_ = base;
+    LOG_INFO("Using MIB index {} ({} objects)", path, size_t(h->sections[kObjects].count));
+    return true;
+}
+
+template <class T>
+const T *MibIndex::section(size_t idx) const {
+    return reinterpret_cast<const T *>(base_ + hdr_->sections[idx].off);
+}
+
+std::string_view MibIndex::str(uint32_t off, uint32_t len) const {
+    return std::string_view(section<char>(kPool) + off, len);
+}
+
+size_t MibIndex::size() const {
+    return hdr_ ? hdr_->sections[kObjects].count : 0;
+}
+
+MibIndex::Object MibIndex::object(size_t i) const {
+    const Entry &e = section<Entry>(kObjects)[i];
+    return Object{str(e.module_off, e.module_len), str(e.name_off, e.name_len),
+                  section<uint32_t>(kArcs) + e.arc_off, e.arc_len, str(e.syntax_off, e.syntax_len),
+                  str(e.units_off, e.units_len), str(e.descr_off, e.descr_len)};
+}
+
+bool MibIndex::resolve(std::string_view name, std::vector<uint32_t> &arcs) const {
+    std::string_view module;
+    size_t sep = name.find("::");
+    if (sep != std::string_view::npos) {
+        module = name.substr(0, sep);
+        name.remove_prefix(sep + 2);
+    }
+    size_t dot = name.find('.');
+    std::string_view label = name.substr(0, dot);
+    std::vector<uint32_t> suffix;
+    while (dot != std::string_view::npos) {
+        size_t next = name.find('.', dot + 1);
+        std::string_view arc = name.substr(dot + 1, next == std::string_view::npos ? next : next - dot - 1);
+        if (arc.empty() || arc.size() > 10 || !std::all_of(arc.begin(), arc.end(), [](char c) { return isdigit((unsigned char)c); }))
+            return false;
+        unsigned long v = std::stoul(std::string(arc));
+        if (v > UINT32_MAX) return false;
+        suffix.push_back((uint32_t)v);
+        dot = next;
+    }
+    if (!hdr_ || label.empty()) return false;
+    const uint32_t *order = section<uint32_t>(kByName);
+    const uint32_t *end = order + size();
+    const uint32_t *it = std::lower_bound(order, end, label, [&](uint32_t i, std::string_view l) {
+        return object(i).name < l;
+    });
+    for (; it != end && object(*it).name == label; ++it) {
+        Object o = object(*it);
+        if (!module.empty() && o.module != module) continue;
+        arcs.assign(o.arcs, o.arcs + o.len);
+        arcs.insert(arcs.end(), suffix.begin(), suffix.end());
+        return true;
+    }
+    return false;
+}
+
+bool MibIndex::find(const uint32_t *arcs, size_t len, Object &obj) const {
+    if (!hdr_) return false;
+    const uint32_t *order = section<uint32_t>(kByOid);
+    const uint32_t *end = order + size();
+    for (size_t k = len; k > 0; --k) {
+        const uint32_t *it = std::lower_bound(order, end, k, [&](uint32_t i, size_t n) {
+            Object o = object(i);
+            return std::lexicographical_compare(o.arcs, o.arcs + o.len, arcs, arcs + n);
+        });
+        if (it == end) continue;
+        Object o = object(*it);
+        if (o.len == k && std::equal(o.arcs, o.arcs + o.len, arcs)) {
+            obj = o;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::shared_ptr<OIDMapping> MibIndex::mapping(const std::vector<std::vector<uint32_t>> &oids) const {
+    std::vector<OIDMapping::Source> rules;
+    std::deque<std::string> strings; // the sources only hold views
+    std::set<const uint32_t *> columns;
+    for (const auto &oid : oids) {
+        Object o;
+        if (oid.empty() || !find(oid.data(), oid.size(), o) || o.syntax.empty() || o.len == oid.size()) continue;
+        bool scalar = oid.size() == o.len + 1 && oid.back() == 0;
+        if (!scalar && !columns.insert(o.arcs).second) continue;
+        const std::string &name = strings.emplace_back("snmp." + std::string(o.name));
+        const std::string &unit = strings.emplace_back(ucum_unit(o.units, o.syntax));
+        std::string_view type = counter_syntax(o.syntax) ? "counter" : "gauge";
+        rules.push_back({scalar ? oid.data() : o.arcs, scalar ? oid.size() : o.len, !scalar, name, unit, type});
+    }
+    if (rules.empty()) return nullptr;
+    return std::make_shared<OIDMapping>(rules);
+}
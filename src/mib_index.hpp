@@ -0,0 +1,62 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "mapping.hpp"
+
+// Symbolic names of MIB objects compiled ahead of time, so OID files can say
+// IF-MIB::ifInOctets.1 without net-snmp parsing MIBs at start up. compile()
+// reads SMIv1/SMIv2 modules with a small parser of its own: OBJECT IDENTIFIER
+// assignments and the OID-valued macros (OBJECT-TYPE, MODULE-IDENTITY, ...),
+// keeping SYNTAX, UNITS and DESCRIPTION of object types. The index is one flat
+// file of arrays (string pool, objects, arcs, objects sorted by name and by
+// OID) mapped read-only and searched in place, like the configuration snapshot
+class MibIndex {
+public:
+    struct Object {
+        std::string_view module;
+        std::string_view name;
+        const uint32_t *arcs;
+        size_t len;
+        std::string_view syntax; // OBJECT-TYPE only, e.g. Counter64 or OCTET STRING
+        std::string_view units;
+        std::string_view description;
+    };
+
+    // Parses every module file in dirs and writes the index to path (temporary file + rename)
+    static bool compile(const std::string &path, const std::vector<std::string> &dirs);
+    // Maps an index, false when it is missing or invalid
+    bool open(const std::string &path);
+
+    size_t size() const;
+    Object object(size_t i) const;
+    // "IF-MIB::ifInOctets.1" or "ifInOctets.1", the arcs after the name are appended
+    bool resolve(std::string_view name, std::vector<uint32_t> &arcs) const;
+    // Object with the longest OID that is a prefix of arcs
+    bool find(const uint32_t *arcs, size_t len, Object &obj) const;
+    // Rules for the given instance OIDs from their object types: "snmp.<name>",
+    // the units in UCUM where known, counter for Counter syntaxes, gauge otherwise.
+    // Scalars (.0) get exact rules, other instances a rule for their column
+    std::shared_ptr<OIDMapping> mapping(const std::vector<std::vector<uint32_t>> &oids) const;
+
+    struct Header;
+
+private:
+    struct Entry {
+        uint32_t module_off, module_len;
+        uint32_t name_off, name_len;
+        uint32_t arc_off, arc_len;
+        uint32_t syntax_off, syntax_len;
+        uint32_t units_off, units_len;
+        uint32_t descr_off, descr_len;
+    };
+    std::shared_ptr<const void> map_; // unmapped with the last user
+    const Header *hdr_ = nullptr;
+    const char *base_ = nullptr;
+
+    template <class T>
+    const T *section(size_t idx) const;
+    std::string_view str(uint32_t off, uint32_t len) const;
+};
@@ -1,112 +1,255 @@
 #include "otel.hpp"
-#include <sstream>
-#include <sys/socket.h>
-#include <netdb.h>
-#include <unistd.h>
-#include <cstring>
-#include <iostream>
-#include <httplib.h>
+#include "config.hpp"
+#include "telemetry.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <charconv>
 #include <nlohmann/json.hpp>
 
-OTELExporter::OTELExporter(const std::string &endpoint, bool verbose)
-: endpoint_(endpoint), verbose_(verbose) {}
+OTELExporter::OTELExporter(const std::vector<std::string> &endpoints,
+                           const BatchLimits &limits, size_t max_queue)
+: limits_(limits) {
+    for (const auto &e : endpoints)
+        destinations_.emplace_back(new Destination(e, max_queue));
+}
 
-bool OTELExporter::parse_endpoint(const std::string &endpoint, std::string &host, int &port, std::string &path) {
-    // support: http://host:port/path
-    if (endpoint.rfind("http://",0) != 0) {
-        if (verbose_) std::cout << "[WARNING] Only http:// endpoints supported in this implementation\n";
-        return false;
-    }
-    size_t p = 7;
-    size_t slash = endpoint.find('/', p);
-    std::string hostport = (slash==std::string::npos) ? endpoint.substr(p) : endpoint.substr(p, slash - p);
-    path = (slash==std::string::npos) ? "/" : endpoint.substr(slash);
-    size_t colon = hostport.find(':');
-    if (colon==std::string::npos) {
-        host = hostport;
-        port = 80;
-    } else {
-        host = hostport.substr(0, colon);
-        port = std::stoi(hostport.substr(colon+1));
-    }
+bool OTELExporter::valid() const {
+    for (const auto &d : destinations_)
+        if (!d->valid()) return false;
+    return !destinations_.empty();
+}
+
+bool OTELExporter::enable_spool(const SpoolOptions &opts) {
+    for (auto &d : destinations_)
+        if (!d->enable_spool(opts)) return false;
     return true;
 }
 
-bool OTELExporter::http_post(const std::string &host, int port,
-                             const std::string &path,
-                             const std::string &body) {
+namespace {
 
-    httplib::Client cli(host, port);
-    cli.set_keep_alive(false);
+const std::string kScopeHead = ",\"scopeMetrics\":[{\"scope\":{\"name\":\"snmp2otel\"},\"metrics\":[";
+const std::string kScopeTail = "]}]}";
 
-    auto res = cli.Post(path.c_str(),
-                        body,
-                        "application/json");
+template <class String>
+void append_int(String &out, int64_t v) {
+    char buf[24];
+    auto r = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, r.ptr);
+}
 
-    if (!res) {
-        if (verbose_) std::cerr << "[ERROR] HTTP request failed (network)\n";
-        return false;
+} // namespace
+
+void OTELExporter::set_resource_attributes(uint32_t target, const std::string &name,
+                                           const std::map<std::string, std::string> &attrs) {
+    nlohmann::json attributes = nlohmann::json::array();
+    attributes.push_back({{"key", "net.host.name"}, {"value", {{"stringValue", name}}}});
+    for (const auto &kv : attrs)
+        attributes.push_back({{"key", kv.first}, {"value", {{"stringValue", kv.second}}}});
+    nlohmann::json resource;
+    resource["attributes"] = attributes;
+    std::string rendered = resource.dump();
+    if (target >= resources_.size()) {
+        resources_.resize(target + 1);
+        templates_.resize(target + 1);
     }
+    if (resources_[target] == rendered) return;
+    resources_[target] = rendered;
+    templates_[target].reset(); // head changed
+}
 
-    if (verbose_) {
-        std::cout << "[DEBUG] HTTP status: " << res->status << "\n";
-        std::cout << "[DEBUG] Response: " << res->body << "\n";
+std::shared_ptr<const ExportTemplate> OTELExporter::build_template(
+    uint32_t target,
+    const SeriesId *ids, size_t count,
+    uint64_t version, const SeriesRegistry &reg)
+{
+    if (target >= resources_.size() || resources_[target].empty())
+        set_resource_attributes(target, reg.target_name(target), {});
+    auto tpl = std::make_shared<ExportTemplate>();
+    tpl->ids.assign(ids, ids + count);
+    tpl->version = version;
+    tpl->head = "{\"resource\":" + resources_[target] + kScopeHead;
+
+    // Group datapoints by metric, rows of a table carry their index as an attribute
+    std::map<uint32_t, std::vector<uint32_t>> grouped; // metric id -> slots
+    for (uint32_t slot = 0; slot < count; ++slot)
+        grouped[reg.metric_id(ids[slot])].push_back(slot);
+
+    for (const auto &g : grouped) {
+        ExportTemplate::Metric m;
+        const MetricDesc &desc = reg.metric(ids[g.second.front()]);
+        std::string frag = "{\"name\":" + nlohmann::json(desc.name).dump() +
+                           ",\"unit\":" + nlohmann::json(desc.unit).dump() +
+                           // Counter rules become cumulative monotonic sums
+                           (desc.counter ? ",\"sum\":{\"aggregationTemporality\":2,\"isMonotonic\":true,"
+                                         : ",\"gauge\":{") +
+                           "\"dataPoints\":[{\"timeUnixNano\":";
+        for (size_t i = 0; i < g.second.size(); ++i) {
+            const std::string &index = reg.row_index(ids[g.second[i]]);
+            tpl->static_bytes += frag.size() + 9;
+            m.frags.push_back(frag);
+            m.frags.push_back(",\"asInt\":");
+            m.slots.push_back(g.second[i]);
+            frag.clear();
+            if (!index.empty())
+                frag += ",\"attributes\":[{\"key\":\"index\",\"value\":{\"stringValue\":\"" + index + "\"}}]";
+            frag += "}";
+            frag += (i + 1 < g.second.size()) ? ",{\"timeUnixNano\":" : "]}}";
+        }
+        tpl->static_bytes += frag.size() + 1;
+        m.frags.push_back(frag);
+        tpl->metrics.push_back(std::move(m));
     }
+    LOG_DEBUG("Built export template for {} ({} OIDs)", reg.target_name(target), count);
+    return tpl;
+}
 
-    return (res->status >= 200 && res->status < 300);
+bool OTELExporter::export_batch(const SampleBatch &batch, const SeriesRegistry &reg) {
+    bool ok = true;
+    // Samples of one target form a contiguous run
+    for (size_t begin = 0; begin < batch.size();) {
+        uint32_t target = reg.target(batch.series[begin]);
+        size_t end = begin + 1;
+        while (end < batch.size() && reg.target(batch.series[end]) == target) ++end;
+        append_run(target, batch, begin, end, reg);
+        begin = end;
+        if (pending_points_ >= limits_.max_points || pending_bytes_ >= limits_.max_bytes)
+            ok = flush() && ok;
+    }
+    return ok;
 }
 
-bool OTELExporter::export_gauge(
-    const std::map<std::string, SNMPResult> &values,
-    const std::map<std::string, OIDInfo> &mapping) 
+void OTELExporter::append_run(uint32_t target, const SampleBatch &batch, size_t begin, size_t end,
+                              const SeriesRegistry &reg)
 {
-    uint64_t ts = now_unix_nano();
-    nlohmann::json metrics = nlohmann::json::array();
-
-    for (const auto &kv : values) {
-        const std::string &oid = kv.first;
-        const SNMPResult &v = kv.second;
-
-        const auto item = mapping.find(oid);
-        std::string name = (item != mapping.end()) ? item->second.name : oid;
-        std::string unit = (item != mapping.end()) ? item->second.unit : "";
-
-        nlohmann::json dp; // datapoint
-        dp["timeUnixNano"] = ts;
-        dp["Int"] = v.value; // integer value
-
-        nlohmann::json metric;
-        metric["name"] = name;
-        metric["unit"] = unit;
-        metric["gauge"]["dataPoints"] = nlohmann::json::array({dp});
-
-        metrics.push_back(metric);
+    telemetry::ScopedTimer timer(telemetry::EncodeNs);
+    if (pending_points_ == 0) batch_start_ns_ = now_unix_nano();
+    if (target >= templates_.size()) {
+        resources_.resize(target + 1);
+        templates_.resize(target + 1);
     }
-
-    nlohmann::json body;
-    body["resourceMetrics"] = {
-        {
-            {"resource", {}},
-            {"scopeMetrics", {{
-                {"scope", {}},
-                {"metrics", metrics}
-            }}}
+    const SeriesId *ids = batch.series.data() + begin;
+    size_t count = end - begin;
+
+    // Reuse the template while the returned series set stays the same. Pollers
+    // finish cycles on the old configuration after a reload, so batches of two
+    // versions can alternate and the names must come from the batch's own one
+    uint64_t version = batch.config ? batch.config->version : 0;
+    auto &tpl = templates_[target];
+    if (!tpl || tpl->version != version || tpl->ids.size() != count ||
+        !std::equal(ids, ids + count, tpl->ids.begin()))
+        tpl = build_template(target, ids, count, version, reg);
+
+    // Samples of one response share the timestamp, format it only when it changes
+    char ts_buf[24];
+    size_t ts_len = 0;
+    uint64_t ts_last = 0;
+
+    // Rendered into the cycle arena, sized up front so the string never regrows
+    PendingBlock block(arena_.resource());
+    block.tpl = tpl;
+    block.metrics.reserve(tpl->static_bytes + count * (sizeof(ts_buf) + 21));
+    block.metric_ends.reserve(tpl->metrics.size());
+    for (const auto &m : tpl->metrics) {
+        if (!block.metrics.empty()) block.metrics += ',';
+        block.metrics += m.frags[0];
+        for (size_t i = 0; i < m.slots.size(); ++i) {
+            size_t row = begin + m.slots[i];
+            if (ts_len == 0 || batch.ts[row] != ts_last) {
+                ts_last = batch.ts[row];
+                ts_len = std::to_chars(ts_buf, ts_buf + sizeof(ts_buf), ts_last).ptr - ts_buf;
+            }
+            block.metrics.append(ts_buf, ts_len);
+            block.metrics += m.frags[2 * i + 1];
+            append_int(block.metrics, batch.value[row]);
+            block.metrics += m.frags[2 * i + 2];
         }
-    };
+        block.metric_ends.push_back(block.metrics.size());
+    }
+    pending_bytes_ += tpl->head.size() + block.metrics.size() + kScopeTail.size() + 1;
+    pending_points_ += count;
+    pending_.push_back(std::move(block));
+}
 
-    std::string body_str = body.dump(); // compact JSON string
+bool OTELExporter::flush_if_due() {
+    for (auto &d : destinations_) d->drain();
+    bool ok = true;
+    if (pending_points_ > 0 && now_unix_nano() - batch_start_ns_ >= (uint64_t)limits_.max_delay_ms * 1000000ull)
+        ok = flush();
+    size_t queued = 0;
+    for (const auto &d : destinations_) queued += d->queued();
+    telemetry::set(telemetry::QueueDepth, (int64_t)queued);
+    return ok;
+}
 
-    if (verbose_) std::cout << "[DEBUG] OTLP JSON:\n" << body.dump(2) << "\n";
+bool OTELExporter::flush() {
+    static const std::string head = "{\"resourceMetrics\":[";
+    static const std::string tail = "]}";
+    if (pending_.empty()) return true;
+    bool ok = true;
+
+    // The request body outlives the cycle (queues, spool), so it is a plain string
+    // allocated once at its final size
+    const size_t body_reserve = std::min(pending_bytes_ + head.size() + tail.size(), limits_.max_request_bytes);
+    std::string body_str;
+    body_str.reserve(body_reserve);
+    body_str = head;
+    size_t blocks = 0; // resource blocks in body_str
+    uint64_t build_start = telemetry::now_ns();
+    auto send = [&]() {
+        body_str += tail;
+        telemetry::record(telemetry::SerializeNs, telemetry::now_ns() - build_start);
+        LOG_DEBUG("OTLP JSON ({} resources):\n{}", blocks, body_str);
+        ok = deliver(std::move(body_str)) && ok;
+        build_start = telemetry::now_ns();
+        body_str = std::string();
+        body_str.reserve(body_reserve);
+        body_str = head;
+        blocks = 0;
+    };
+    auto append_block = [&](const PendingBlock &b, size_t from, size_t to) {
+        if (blocks > 0) body_str += ',';
+        body_str += b.tpl->head;
+        body_str.append(b.metrics, from, to - from);
+        body_str += kScopeTail;
+        ++blocks;
+    };
 
-    std::string host; int port; std::string path;
-    if (!parse_endpoint(endpoint_, host, port, path)) {
-       if(verbose_) std::cerr << "[ERROR] Unsupported endpoint format\n";
-        return false;
+    for (const auto &b : pending_) {
+        // Split so that no request exceeds the collector's maximum size
+        size_t overhead = b.tpl->head.size() + kScopeTail.size() + tail.size() + 1;
+        if (body_str.size() + overhead + b.metrics.size() <= limits_.max_request_bytes) {
+            append_block(b, 0, b.metrics.size());
+            continue;
+        }
+        if (blocks > 0) send();
+        // Oversized block, cut it at metric boundaries
+        size_t from = 0;
+        for (size_t i = 0; i < b.metric_ends.size(); ++i) {
+            size_t end = b.metric_ends[i];
+            bool last = i + 1 == b.metric_ends.size();
+            if (!last && body_str.size() + overhead + b.metric_ends[i + 1] - from <= limits_.max_request_bytes) continue;
+            append_block(b, from, end);
+            from = end + 1; // skip the separating comma
+            if (!last) send();
+        }
     }
+    send();
+
+    pending_.clear();
+    arena_.reset();
+    pending_bytes_ = 0;
+    pending_points_ = 0;
+    return ok;
+}
 
-    bool ok = http_post(host, port, path, body_str);
-    if (!ok)
-        if (verbose_) std::cerr << "[ERROR] Export failed for endpoint " << endpoint_ << "\n";
+bool OTELExporter::export_resource_metrics(const std::string &resource_metrics) {
+    return deliver("{\"resourceMetrics\":[" + resource_metrics + "]}");
+}
 
+bool OTELExporter::deliver(std::string body) {
+    auto payload = std::make_shared<const Payload>(std::move(body));
+    bool ok = true;
+    for (auto &d : destinations_)
+        ok = d->deliver(payload) && ok;
     return ok;
-}
\ No newline at end of file
+}
@@ -1,17 +1,79 @@
 #pragma once
 #include <string>
 #include <map>
-#include "snmp.hpp"
-#include "utils.hpp"
+#include <vector>
+#include <memory>
+#include "series.hpp"
+#include "sample_batch.hpp"
+#include "destination.hpp"
+#include "arena.hpp"
+
+// Thresholds for coalescing datapoints of many targets into one request.
+// A batch is flushed when any of max_points, max_bytes or max_delay_ms is reached
+struct BatchLimits {
+    size_t max_points = 10000;
+    size_t max_bytes = 1u << 20;
+    int max_delay_ms = 0; // 0 flushes on every flush_if_due() call
+    size_t max_request_bytes = 4u << 20; // collector limit, larger batches are split
+};
+
+// Pre-rendered JSON of one target's ResourceMetrics for a fixed series set.
+// Each cycle only timestamps and values are written between the fragments
+struct ExportTemplate {
+    std::vector<SeriesId> ids; // series set the template was built for, in poll order
+    uint64_t version = 0; // configuration version the names and units come from
+    std::string head; // resource and scope up to the metrics array
+    struct Metric {
+        std::vector<std::string> frags; // 2 * slots.size() + 1 fragments around (timestamp, value) pairs
+        std::vector<uint32_t> slots; // position of the series in ids
+    };
+    std::vector<Metric> metrics;
+    size_t static_bytes = 0; // size of all fragments, for reserving the rendered block
+};
 
 class OTELExporter {
 public:
-    OTELExporter(const std::string &endpoint, bool verbose=false);
-    bool export_gauge(const std::map<std::string, SNMPResult> &values,
-                      const std::map<std::string, OIDInfo> &mapping);
+    // Every request is serialized once and fanned out to all endpoints, each
+    // sending from its own thread
+    explicit OTELExporter(const std::vector<std::string> &endpoints,
+                          const BatchLimits &limits=BatchLimits(), size_t max_queue=64);
+    // Adds the samples (contiguous runs per target) to the pending batch,
+    // flushing it whenever a size threshold is reached
+    bool export_batch(const SampleBatch &batch, const SeriesRegistry &reg);
+    // Caches attributes (sysName, sysObjectID, ...) put on the target's ResourceMetrics
+    void set_resource_attributes(uint32_t target, const std::string &name,
+                                 const std::map<std::string, std::string> &attrs);
+    // Flushes the pending batch once max_delay_ms has passed since its first datapoint,
+    // and retries destinations whose backoff elapsed
+    bool flush_if_due();
+    bool flush();
+    // Sends one pre-rendered ResourceMetrics object (self-telemetry) as its own request
+    bool export_resource_metrics(const std::string &resource_metrics);
+    // Drops all pre-rendered templates, e.g. after the mapping changed
+    void invalidate_templates() { for (auto &t : templates_) t.reset(); }
+    // Gives every destination its own spool below opts.dir
+    bool enable_spool(const SpoolOptions &opts);
+    bool valid() const;
 private:
-    std::string endpoint_;
-    bool verbose_;
-    bool http_post(const std::string &host, int port, const std::string &path, const std::string &body);
-    bool parse_endpoint(const std::string &endpoint, std::string &host, int &port, std::string &path);
+    std::vector<std::unique_ptr<Destination>> destinations_;
+    BatchLimits limits_;
+    std::vector<std::string> resources_; // serialized resource object by target ID
+    std::vector<std::shared_ptr<const ExportTemplate>> templates_; // by target ID
+    // One rendered cycle of a target waiting for the next flush, lives in arena_
+    struct PendingBlock {
+        explicit PendingBlock(std::pmr::memory_resource *mr) : metrics(mr), metric_ends(mr) {}
+        std::shared_ptr<const ExportTemplate> tpl;
+        std::pmr::string metrics; // comma separated metric objects
+        std::pmr::vector<size_t> metric_ends; // split points for oversized blocks
+    };
+    std::vector<PendingBlock> pending_;
+    CycleArena arena_; // released in bulk after every flush
+    size_t pending_bytes_ = 0;
+    size_t pending_points_ = 0;
+    uint64_t batch_start_ns_ = 0;
+    std::shared_ptr<const ExportTemplate> build_template(uint32_t target, const SeriesId *ids, size_t count,
+                                                         uint64_t version, const SeriesRegistry &reg);
+    void append_run(uint32_t target, const SampleBatch &batch, size_t begin, size_t end,
+                    const SeriesRegistry &reg);
+    bool deliver(std::string body);
 };
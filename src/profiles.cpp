@@ -0,0 +1,154 @@
+#include "profiles.hpp"
+
+namespace {
+
+// Scalar and column rows
+constexpr ProfileObject scalar(const char *oid, const char *name, const char *unit, const char *type) {
+    return ProfileObject{ProfileOid(oid), name, unit, type, false, 0};
+}
+constexpr ProfileObject column(const char *oid, const char *name, const char *unit, const char *type,
+                               uint8_t rows=0) {
+    return ProfileObject{ProfileOid(oid), name, unit, type, true, rows};
+}
+
+// RFC 1213 system, ip, tcp and udp groups
+constexpr ProfileObject kMib2[] = {
+    scalar("1.3.6.1.2.1.1.3.0", "snmp.sysUpTime", "cs", "gauge"),
+    scalar("1.3.6.1.2.1.2.1.0", "snmp.ifNumber", "{interface}", "gauge"),
+    scalar("1.3.6.1.2.1.4.3.0", "snmp.ipInReceives", "{packet}", "counter"),
+    scalar("1.3.6.1.2.1.4.9.0", "snmp.ipInDelivers", "{packet}", "counter"),
+    scalar("1.3.6.1.2.1.4.10.0", "snmp.ipOutRequests", "{packet}", "counter"),
+    scalar("1.3.6.1.2.1.6.5.0", "snmp.tcpActiveOpens", "{connection}", "counter"),
+    scalar("1.3.6.1.2.1.6.6.0", "snmp.tcpPassiveOpens", "{connection}", "counter"),
+    scalar("1.3.6.1.2.1.6.9.0", "snmp.tcpCurrEstab", "{connection}", "gauge"),
+    scalar("1.3.6.1.2.1.6.10.0", "snmp.tcpInSegs", "{segment}", "counter"),
+    scalar("1.3.6.1.2.1.6.11.0", "snmp.tcpOutSegs", "{segment}", "counter"),
+    scalar("1.3.6.1.2.1.6.12.0", "snmp.tcpRetransSegs", "{segment}", "counter"),
+    scalar("1.3.6.1.2.1.7.1.0", "snmp.udpInDatagrams", "{datagram}", "counter"),
+    scalar("1.3.6.1.2.1.7.2.0", "snmp.udpNoPorts", "{datagram}", "counter"),
+    scalar("1.3.6.1.2.1.7.3.0", "snmp.udpInErrors", "{datagram}", "counter"),
+    scalar("1.3.6.1.2.1.7.4.0", "snmp.udpOutDatagrams", "{datagram}", "counter"),
+};
+
+// ifTable and ifXTable, one row per interface
+constexpr ProfileObject kIfMib[] = {
+    column("1.3.6.1.2.1.2.2.1.4", "snmp.ifMtu", "By", "gauge"),
+    column("1.3.6.1.2.1.2.2.1.5", "snmp.ifSpeed", "bit/s", "gauge"),
+    column("1.3.6.1.2.1.2.2.1.7", "snmp.ifAdminStatus", "1", "gauge"),
+    column("1.3.6.1.2.1.2.2.1.8", "snmp.ifOperStatus", "1", "gauge"),
+    column("1.3.6.1.2.1.2.2.1.10", "snmp.ifInOctets", "By", "counter"),
+    column("1.3.6.1.2.1.2.2.1.11", "snmp.ifInUcastPkts", "{packet}", "counter"),
+    column("1.3.6.1.2.1.2.2.1.13", "snmp.ifInDiscards", "{packet}", "counter"),
+    column("1.3.6.1.2.1.2.2.1.14", "snmp.ifInErrors", "{packet}", "counter"),
+    column("1.3.6.1.2.1.2.2.1.16", "snmp.ifOutOctets", "By", "counter"),
+    column("1.3.6.1.2.1.2.2.1.17", "snmp.ifOutUcastPkts", "{packet}", "counter"),
+    column("1.3.6.1.2.1.2.2.1.19", "snmp.ifOutDiscards", "{packet}", "counter"),
+    column("1.3.6.1.2.1.2.2.1.20", "snmp.ifOutErrors", "{packet}", "counter"),
+    column("1.3.6.1.2.1.31.1.1.1.6", "snmp.ifHCInOctets", "By", "counter"),
+    column("1.3.6.1.2.1.31.1.1.1.10", "snmp.ifHCOutOctets", "By", "counter"),
+    column("1.3.6.1.2.1.31.1.1.1.15", "snmp.ifHighSpeed", "Mbit/s", "gauge"),
+};
+
+// RFC 2790 system, storage and processor groups
+constexpr ProfileObject kHostResources[] = {
+    scalar("1.3.6.1.2.1.25.1.1.0", "snmp.hrSystemUptime", "cs", "gauge"),
+    scalar("1.3.6.1.2.1.25.1.5.0", "snmp.hrSystemNumUsers", "{user}", "gauge"),
+    scalar("1.3.6.1.2.1.25.1.6.0", "snmp.hrSystemProcesses", "{process}", "gauge"),
+    scalar("1.3.6.1.2.1.25.2.2.0", "snmp.hrMemorySize", "KiBy", "gauge"),
+    column("1.3.6.1.2.1.25.2.3.1.4", "snmp.hrStorageAllocationUnits", "By", "gauge"),
+    column("1.3.6.1.2.1.25.2.3.1.5", "snmp.hrStorageSize", "{unit}", "gauge"),
+    column("1.3.6.1.2.1.25.2.3.1.6", "snmp.hrStorageUsed", "{unit}", "gauge"),
+    column("1.3.6.1.2.1.25.3.3.1.2", "snmp.hrProcessorLoad", "%", "gauge"),
+};
+
+// net-snmp agent extensions: memory, load averages, CPU and disks
+constexpr ProfileObject kUcd[] = {
+    scalar("1.3.6.1.4.1.2021.4.3.0", "snmp.memTotalSwap", "KiBy", "gauge"),
+    scalar("1.3.6.1.4.1.2021.4.4.0", "snmp.memAvailSwap", "KiBy", "gauge"),
+    scalar("1.3.6.1.4.1.2021.4.5.0", "snmp.memTotalReal", "KiBy", "gauge"),
+    scalar("1.3.6.1.4.1.2021.4.6.0", "snmp.memAvailReal", "KiBy", "gauge"),
+    scalar("1.3.6.1.4.1.2021.4.11.0", "snmp.memTotalFree", "KiBy", "gauge"),
+    scalar("1.3.6.1.4.1.2021.4.13.0", "snmp.memShared", "KiBy", "gauge"),
+    scalar("1.3.6.1.4.1.2021.4.14.0", "snmp.memBuffer", "KiBy", "gauge"),
+    scalar("1.3.6.1.4.1.2021.4.15.0", "snmp.memCached", "KiBy", "gauge"),
+    column("1.3.6.1.4.1.2021.10.1.5", "snmp.laLoadInt", "%", "gauge", 3), // 1, 5 and 15 minutes
+    scalar("1.3.6.1.4.1.2021.11.50.0", "snmp.ssCpuRawUser", "{tick}", "counter"),
+    scalar("1.3.6.1.4.1.2021.11.51.0", "snmp.ssCpuRawNice", "{tick}", "counter"),
+    scalar("1.3.6.1.4.1.2021.11.52.0", "snmp.ssCpuRawSystem", "{tick}", "counter"),
+    scalar("1.3.6.1.4.1.2021.11.53.0", "snmp.ssCpuRawIdle", "{tick}", "counter"),
+    scalar("1.3.6.1.4.1.2021.11.54.0", "snmp.ssCpuRawWait", "{tick}", "counter"),
+    scalar("1.3.6.1.4.1.2021.11.57.0", "snmp.ssIORawSent", "{block}", "counter"),
+    scalar("1.3.6.1.4.1.2021.11.58.0", "snmp.ssIORawReceived", "{block}", "counter"),
+    scalar("1.3.6.1.4.1.2021.11.59.0", "snmp.ssRawInterrupts", "{interrupt}", "counter"),
+    scalar("1.3.6.1.4.1.2021.11.60.0", "snmp.ssRawContexts", "{switch}", "counter"),
+    column("1.3.6.1.4.1.2021.9.1.6", "snmp.dskTotal", "KiBy", "gauge"),
+    column("1.3.6.1.4.1.2021.9.1.7", "snmp.dskAvail", "KiBy", "gauge"),
+    column("1.3.6.1.4.1.2021.9.1.8", "snmp.dskUsed", "KiBy", "gauge"),
+    column("1.3.6.1.4.1.2021.9.1.9", "snmp.dskPercent", "%", "gauge"),
+};
+
+// net-snmp agents and Windows implement HOST-RESOURCES, only net-snmp has UCD
+constexpr ProfileOid kHostResourcesAgents[] = {"1.3.6.1.4.1.8072", "1.3.6.1.4.1.311"};
+constexpr ProfileOid kUcdAgents[] = {"1.3.6.1.4.1.8072", "1.3.6.1.4.1.2021"};
+
+template <class T, size_t N>
+constexpr size_t count_of(const T (&)[N]) { return N; }
+
+constexpr DeviceProfile kProfiles[] = {
+    {"mib2", kMib2, count_of(kMib2), nullptr, 0},
+    {"if-mib", kIfMib, count_of(kIfMib), nullptr, 0},
+    {"host-resources", kHostResources, count_of(kHostResources), kHostResourcesAgents, count_of(kHostResourcesAgents)},
+    {"ucd", kUcd, count_of(kUcd), kUcdAgents, count_of(kUcdAgents)},
+};
+
+// Dotted sysObjectID starts with the prefix, on an arc boundary
+bool has_prefix(const std::string &oid, const ProfileOid &prefix) {
+    size_t pos = 0;
+    if (!oid.empty() && oid[0] == '.') ++pos;
+    for (uint8_t i = 0; i < prefix.len; ++i) {
+        if (i > 0) {
+            if (pos >= oid.size() || oid[pos] != '.') return false;
+            ++pos;
+        }
+        uint64_t v = 0;
+        size_t start = pos;
+        while (pos < oid.size() && oid[pos] >= '0' && oid[pos] <= '9' && v <= UINT32_MAX)
+            v = v * 10 + (uint64_t)(oid[pos++] - '0');
+        if (pos == start || v != prefix.arcs[i]) return false;
+    }
+    return pos == oid.size() || oid[pos] == '.';
+}
+
+} // namespace
+
+const DeviceProfile *device_profiles(size_t &count) {
+    count = count_of(kProfiles);
+    return kProfiles;
+}
+
+const DeviceProfile *find_profile(const std::string &name) {
+    for (const auto &p : kProfiles)
+        if (name == p.name) return &p;
+    return nullptr;
+}
+
+std::vector<const DeviceProfile *> profiles_for_sys_object_id(const std::string &sys_object_id) {
+    std::vector<const DeviceProfile *> out;
+    for (const auto &p : kProfiles) {
+        bool match = p.sys_object_id_count == 0;
+        for (size_t i = 0; i < p.sys_object_id_count && !match; ++i)
+            match = has_prefix(sys_object_id, p.sys_object_ids[i]);
+        if (match) out.push_back(&p);
+    }
+    return out;
+}
+
+std::shared_ptr<OIDMapping> profile_mapping(const std::vector<const DeviceProfile *> &profiles) {
+    std::vector<OIDMapping::Source> rules;
+    for (const DeviceProfile *p : profiles)
+        for (size_t i = 0; i < p->object_count; ++i) {
+            const ProfileObject &o = p->objects[i];
+            rules.push_back({o.oid.arcs, o.oid.len, o.column, o.name, o.unit, o.type});
+        }
+    return std::make_shared<OIDMapping>(rules);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include "mapping.hpp"
+
+constexpr size_t kMaxProfileArcs = 16;
+
+// OID written as a dotted literal and split into arcs by the compiler.
+// A malformed literal in a constexpr table does not compile
+struct ProfileOid {
+    uint32_t arcs[kMaxProfileArcs] = {};
+    uint8_t len = 0;
+
+    constexpr ProfileOid(const char *s) {
+        uint32_t v = 0;
+        for (; *s; ++s) {
+            if (*s == '.') {
+                if (len == kMaxProfileArcs) throw "OID too long";
+                arcs[len++] = v;
+                v = 0;
+            } else if (*s >= '0' && *s <= '9') {
+                v = v * 10 + (uint32_t)(*s - '0');
+            } else {
+                throw "OID literal must be numeric";
+            }
+        }
+        if (len == kMaxProfileArcs) throw "OID too long";
+        arcs[len++] = v;
+    }
+};
+
+// One polled object of a profile. Scalars are the full OID (ending with .0),
+// columns are polled for rows 1..rows, or 1..--profile-rows when rows is 0
+struct ProfileObject {
+    ProfileOid oid;
+    const char *name;
+    const char *unit;
+    const char *type;
+    bool column;
+    uint8_t rows;
+};
+
+// Built-in set of objects for a class of devices, compiled into the binary
+struct DeviceProfile {
+    const char *name;
+    const ProfileObject *objects;
+    size_t object_count;
+    // sysObjectID prefixes selecting the profile in auto mode, none: every device
+    const ProfileOid *sys_object_ids;
+    size_t sys_object_id_count;
+};
+
+// All built-in profiles
+const DeviceProfile *device_profiles(size_t &count);
+// nullptr when no profile has that name
+const DeviceProfile *find_profile(const std::string &name);
+// Profiles that apply to a device, by its sysObjectID ("1.3.6.1.4.1.8072.3.2.10")
+std::vector<const DeviceProfile *> profiles_for_sys_object_id(const std::string &sys_object_id);
+// Mapping rules of the objects of the profiles, built from the tables without parsing
+std::shared_ptr<OIDMapping> profile_mapping(const std::vector<const DeviceProfile *> &profiles);
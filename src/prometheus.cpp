@@ -0,0 +1,133 @@
+#include "prometheus.hpp"
+#include "config.hpp"
+#include "log.hpp"
+#include <charconv>
+#include <algorithm>
+#include <httplib.h>
+
+namespace {
+
+// Prometheus metric names allow [a-zA-Z_:][a-zA-Z0-9_:]*
+std::string sanitize_name(const std::string &name) {
+    std::string out;
+    if (name.empty() || isdigit((unsigned char)name[0])) out = "oid_";
+    for (char c : name) out += (isalnum((unsigned char)c) || c == '_' || c == ':') ? c : '_';
+    return out;
+}
+
+std::string escape_label(const std::string &v) {
+    std::string out;
+    for (char c : v) {
+        if (c == '\\' || c == '"') out += '\\';
+        if (c == '\n') { out += "\\n"; continue; }
+        out += c;
+    }
+    return out;
+}
+
+} // namespace
+
+PrometheusServer::PrometheusServer(int port)
+: port_(port) {}
+
+PrometheusServer::~PrometheusServer() {
+    stop();
+}
+
+bool PrometheusServer::start() {
+    server_.reset(new httplib::Server());
+    server_->Get("/metrics", [this](const httplib::Request &, httplib::Response &res) {
+        res.set_content(read_snapshot(), "text/plain; version=0.0.4");
+    });
+    if (!server_->bind_to_port("0.0.0.0", port_)) {
+        LOG_ERROR("Cannot listen on port {} for Prometheus scrapes", port_);
+        return false;
+    }
+    thread_ = std::thread([this]() { server_->listen_after_bind(); });
+    LOG_INFO("Serving Prometheus metrics on port {}", port_);
+    return true;
+}
+
+void PrometheusServer::stop() {
+    if (!server_) return;
+    server_->stop();
+    if (thread_.joinable()) thread_.join();
+    server_.reset();
+}
+
+void PrometheusServer::update(const SampleBatch &batch, const SeriesRegistry &reg) {
+    if (series_.size() < reg.size()) series_.resize(reg.size());
+    // Batches of the previous configuration version may still follow a reload
+    uint64_t version = batch.config ? batch.config->version : 0;
+    for (size_t row = 0; row < batch.size(); ++row) {
+        SeriesId id = batch.series[row];
+        Series &s = series_[id];
+        if (s.prefix.empty() || s.version != version) {
+            // First sighting in this version, render the series prefix once
+            const MetricDesc &desc = reg.metric(id);
+            std::string name = sanitize_name(desc.name);
+            bool listed = !s.prefix.empty() && s.family == name;
+            if (!s.prefix.empty() && !listed) unlink_series(s.family, id);
+            s.prefix = name + "{target=\"" + escape_label(reg.target_name(reg.target(id))) + "\"";
+            if (!reg.row_index(id).empty()) s.prefix += ",index=\"" + reg.row_index(id) + "\"";
+            s.prefix += "} ";
+            s.family = name;
+            s.version = version;
+            Family &f = families_[name];
+            // The rule type may change with the version even when the name does not
+            f.header = "# TYPE " + name + (desc.counter ? " counter\n" : " gauge\n");
+            if (!listed) f.series.push_back(id);
+        }
+        s.value = batch.value[row];
+        s.ts_ms = batch.ts[row] / 1000000ull;
+    }
+}
+
+void PrometheusServer::unlink_series(const std::string &family, size_t id) {
+    auto it = families_.find(family);
+    if (it == families_.end()) return;
+    auto &ids = it->second.series;
+    ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+    if (ids.empty()) families_.erase(it);
+}
+
+void PrometheusServer::reset() {
+    series_.clear();
+    families_.clear();
+}
+
+void PrometheusServer::publish() {
+    int back = 1 - front_.load();
+    // Wait for scrapes still copying the old back buffer, they only hold it briefly
+    while (bufs_[back].readers.load() > 0) std::this_thread::yield();
+
+    std::string &out = bufs_[back].text;
+    out.clear();
+    char num[24];
+    for (const auto &f : families_) {
+        out += f.second.header;
+        for (size_t i : f.second.series) {
+            const Series &s = series_[i];
+            out += s.prefix;
+            out.append(num, std::to_chars(num, num + sizeof(num), s.value).ptr);
+            out += ' ';
+            out.append(num, std::to_chars(num, num + sizeof(num), s.ts_ms).ptr);
+            out += '\n';
+        }
+    }
+    front_.store(back);
+}
+
+std::string PrometheusServer::read_snapshot() {
+    for (;;) {
+        int i = front_.load();
+        bufs_[i].readers.fetch_add(1);
+        if (front_.load() == i) {
+            std::string copy = bufs_[i].text;
+            bufs_[i].readers.fetch_sub(1);
+            return copy;
+        }
+        // publish() swapped buffers meanwhile, retry on the new front
+        bufs_[i].readers.fetch_sub(1);
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include "series.hpp"
+#include "sample_batch.hpp"
+
+namespace httplib { class Server; }
+
+// Latest-value store served as a Prometheus text exposition on /metrics.
+// The poll loop updates values and publishes a rendered snapshot once per cycle;
+// scrapes read the published buffer only and never wait for the poller
+class PrometheusServer {
+public:
+    explicit PrometheusServer(int port);
+    ~PrometheusServer();
+    bool start();
+    void stop();
+    // Records the latest value of every sample in the batch
+    void update(const SampleBatch &batch, const SeriesRegistry &reg);
+    // Renders the store into the back buffer and swaps it in
+    void publish();
+    // Forgets cached names after a configuration change, values come back with the next update
+    void reset();
+    // Text of the last publish(), as served to scrapes
+    std::string snapshot() { return read_snapshot(); }
+
+private:
+    struct Series {
+        std::string prefix; // cached 'name{labels} ', empty until first seen
+        std::string family; // sanitized metric name the prefix was rendered with
+        uint64_t version = 0; // configuration version of the prefix
+        int64_t value = 0;
+        uint64_t ts_ms = 0;
+    };
+    struct Family {
+        std::string header; // cached '# TYPE' line
+        std::vector<size_t> series;
+    };
+    int port_;
+    std::vector<Series> series_; // by SeriesId
+    std::map<std::string, Family> families_; // by sanitized metric name
+
+    // Double buffer, readers pin the front buffer with a counter
+    struct Buffer {
+        std::string text;
+        std::atomic<int> readers{0};
+    };
+    Buffer bufs_[2];
+    std::atomic<int> front_{0};
+
+    std::unique_ptr<httplib::Server> server_;
+    std::thread thread_;
+
+    std::string read_snapshot();
+    // Removes a series from a family whose name it no longer has
+    void unlink_series(const std::string &family, size_t id);
+};
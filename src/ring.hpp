@@ -0,0 +1,113 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Bounded lock-free ring buffers used to hand sample batches between pipeline
+// threads. Capacity is rounded up to a power of two; push/pop never block and
+// return false when the ring is full/empty.
+
+constexpr size_t kCacheLine = 64;
+
+inline size_t ring_capacity(size_t n) {
+    size_t c = 2;
+    while (c < n) c <<= 1;
+    return c;
+}
+
+// Single producer, single consumer
+template <class T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+    : slots_(ring_capacity(capacity)), mask_(slots_.size() - 1) {}
+
+    bool push(const T &v) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ == slots_.size()) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ == slots_.size()) return false;
+        }
+        slots_[tail & mask_] = v;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &v) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) return false;
+        }
+        v = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return slots_.size(); }
+
+private:
+    std::vector<T> slots_;
+    const size_t mask_;
+    // Producer and consumer state on separate cache lines, each side caches
+    // the other's index to avoid touching the shared line on every call
+    alignas(kCacheLine) std::atomic<size_t> tail_{0};
+    size_t head_cache_ = 0;
+    alignas(kCacheLine) std::atomic<size_t> head_{0};
+    size_t tail_cache_ = 0;
+};
+
+// Multiple producers, single consumer. Every slot carries a sequence number
+// telling whether it is free for the producer of that lap or filled for the consumer
+template <class T>
+class MpscRing {
+public:
+    explicit MpscRing(size_t capacity)
+    : slots_(ring_capacity(capacity)), mask_(slots_.size() - 1) {
+        for (size_t i = 0; i < slots_.size(); ++i) slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    bool push(const T &v) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &s = slots_[pos & mask_];
+            size_t seq = s.seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                // Slot is free for this lap, claim it
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    s.value = v;
+                    s.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(T &v) {
+        Slot &s = slots_[head_ & mask_];
+        size_t seq = s.seq.load(std::memory_order_acquire);
+        if ((intptr_t)seq - (intptr_t)(head_ + 1) < 0) return false; // empty or still being written
+        v = s.value;
+        s.seq.store(head_ + slots_.size(), std::memory_order_release);
+        ++head_;
+        return true;
+    }
+
+    size_t capacity() const { return slots_.size(); }
+
+private:
+    struct alignas(kCacheLine) Slot {
+        std::atomic<size_t> seq;
+        T value;
+    };
+    std::vector<Slot> slots_;
+    const size_t mask_;
+    alignas(kCacheLine) std::atomic<size_t> tail_{0};
+    alignas(kCacheLine) size_t head_ = 0; // consumer only
+};
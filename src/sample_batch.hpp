@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include "series.hpp"
+
+struct Config;
+
+// SNMP type a sample was decoded from
+enum class SampleType : uint8_t {
+    Integer,
+    Gauge,
+    Counter,
+    Counter64,
+    TimeTicks,
+};
+
+// Columnar (structure-of-arrays) batch of samples. The poller appends one row
+// per decoded varbind, the exporter and the scrape store walk the columns
+// sequentially. Samples of one target are appended as one contiguous run.
+// clear() keeps the capacity so a reused batch does not allocate
+struct SampleBatch {
+    std::vector<SeriesId> series;
+    std::vector<uint64_t> ts; // unix nano
+    std::vector<SampleType> type;
+    std::vector<int64_t> value;
+
+    // Resource attributes refreshed by the poller in this cycle (usually none)
+    struct Resource {
+        uint32_t target;
+        std::string name;
+        std::map<std::string, std::string> attrs;
+    };
+    std::vector<Resource> resources;
+    uint32_t owner = 0; // poller whose pool the batch is returned to
+    std::shared_ptr<const Config> config; // configuration version the samples were polled with
+
+    size_t size() const { return series.size(); }
+    bool empty() const { return series.empty(); }
+    void clear() {
+        series.clear();
+        ts.clear();
+        type.clear();
+        value.clear();
+        resources.clear();
+    }
+    void reserve(size_t n) {
+        series.reserve(n);
+        ts.reserve(n);
+        type.reserve(n);
+        value.reserve(n);
+    }
+    void append(SeriesId id, uint64_t t, SampleType ty, int64_t v) {
+        series.push_back(id);
+        ts.push_back(t);
+        type.push_back(ty);
+        value.push_back(v);
+    }
+};
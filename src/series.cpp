@@ -0,0 +1,104 @@
+#include "series.hpp"
+#include <cstdlib>
+
+uint32_t SeriesRegistry::intern_target(const std::string &name) {
+    auto it = target_ids_.find(name);
+    if (it != target_ids_.end()) return it->second;
+    uint32_t t = targets_.size();
+    targets_.push_back(name);
+    target_ids_.emplace(name, t);
+    return t;
+}
+
+// Metric of an OID under mapping, registered on first use; index gets the row index
+uint32_t SeriesRegistry::metric_for(const OIDMapping &mapping, const std::string &oid, const uint32_t *arcs,
+                                    size_t len, std::string &index) {
+    OIDMapping::RuleView rule;
+    bool found = mapping.find(arcs, len, index, rule);
+    MetricDesc desc{found ? std::string(rule.name) : oid, found ? std::string(rule.unit) : "",
+                    found && rule.type == "counter"};
+    auto m = metric_ids_.find(desc.name);
+    if (m == metric_ids_.end()) {
+        m = metric_ids_.emplace(desc.name, (uint32_t)metrics_.size()).first;
+        metrics_.push_back(desc);
+    }
+    return m->second;
+}
+
+void SeriesRegistry::remap(const OIDMapping &mapping) {
+    // Metric IDs are renumbered, names or units may have changed
+    metrics_.clear();
+    metric_ids_.clear();
+    for (SeriesId id = 0; id < size(); ++id)
+        metric_[id] = metric_for(mapping, oids_[id], arcs(id), arcs_len(id), row_index_[id]);
+}
+
+SeriesId SeriesRegistry::find(const std::string &target, const std::string &oid) const {
+    auto t = target_ids_.find(target);
+    if (t == target_ids_.end()) return kInvalidSeries;
+    auto it = ids_.find(std::make_pair(t->second, oid));
+    return it == ids_.end() ? kInvalidSeries : it->second;
+}
+
+SeriesId SeriesRegistry::intern(uint32_t target, const std::string &oid, const OIDMapping &mapping) {
+    auto it = ids_.find(std::make_pair(target, oid));
+    if (it != ids_.end()) return it->second;
+    std::vector<uint32_t> arcs;
+    if (!parse_oid(oid, arcs)) return kInvalidSeries;
+    return intern(target, oid, arcs.data(), arcs.size(), mapping);
+}
+
+SeriesId SeriesRegistry::intern(uint32_t target, const std::string &oid, const uint32_t *arcs, size_t len,
+                                const OIDMapping &mapping) {
+    auto key = std::make_pair(target, oid);
+    auto it = ids_.find(key);
+    if (it != ids_.end()) return it->second;
+
+    std::string index;
+    uint32_t metric = metric_for(mapping, oid, arcs, len, index);
+
+    SeriesId id = target_.size();
+    target_.push_back(target);
+    oids_.push_back(oid);
+    arcs_.insert(arcs_.end(), arcs, arcs + len);
+    arc_off_.push_back(arcs_.size());
+    metric_.push_back(metric);
+    row_index_.push_back(index);
+    ids_.emplace(key, id);
+    return id;
+}
+
+bool parse_oid(const std::string &oid, std::vector<uint32_t> &arcs) {
+    arcs.clear();
+    const char *p = oid.c_str();
+    if (*p == '.') ++p;
+    while (*p) {
+        if (*p < '0' || *p > '9') return false;
+        char *end;
+        unsigned long v = strtoul(p, &end, 10);
+        if (v > UINT32_MAX) return false;
+        arcs.push_back((uint32_t)v);
+        p = end;
+        if (*p == '.') {
+            ++p;
+            if (!*p) return false;
+        } else if (*p) {
+            return false;
+        }
+    }
+    return arcs.size() >= 2;
+}
+
+bool is_requestable(const std::string &oid, const OIDMapping &mapping) {
+    if (oid.size() >= 2 && oid.substr(oid.size() - 2) == ".0") return true;
+    std::vector<uint32_t> arcs;
+    if (!parse_oid(oid, arcs)) return false;
+    return is_requestable(arcs.data(), arcs.size(), mapping);
+}
+
+bool is_requestable(const uint32_t *arcs, size_t len, const OIDMapping &mapping) {
+    if (len >= 1 && arcs[len - 1] == 0) return true;
+    std::string index;
+    OIDMapping::RuleView rule;
+    return mapping.find(arcs, len, index, rule) && !index.empty();
+}
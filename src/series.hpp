@@ -0,0 +1,70 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include "utils.hpp"
+#include "mapping.hpp"
+
+// Dense ID of one (target, OID) pair
+using SeriesId = uint32_t;
+constexpr SeriesId kInvalidSeries = UINT32_MAX;
+
+// Metric metadata shared by all series mapped to it
+struct MetricDesc {
+    std::string name;
+    std::string unit;
+    bool counter = false; // monotonic cumulative sum rather than a gauge
+};
+
+// Interns every (target, OID) pair into a dense SeriesId at configuration time.
+// Everything the per-cycle path needs lives in flat arrays indexed by that ID,
+// so polling and exporting never hash or compare OID strings
+class SeriesRegistry {
+public:
+    uint32_t intern_target(const std::string &name);
+    // Returns kInvalidSeries when the OID is not numeric
+    SeriesId intern(uint32_t target, const std::string &oid, const OIDMapping &mapping);
+    // Same with the OID already parsed into arcs
+    SeriesId intern(uint32_t target, const std::string &oid, const uint32_t *arcs, size_t len,
+                    const OIDMapping &mapping);
+    // Re-resolves metric and row index of every series against a new mapping.
+    // Series IDs stay the same, metric IDs are renumbered
+    void remap(const OIDMapping &mapping);
+    // Lookup without interning (slow path for queries), kInvalidSeries when unknown
+    SeriesId find(const std::string &target, const std::string &oid) const;
+
+    size_t size() const { return target_.size(); }
+    size_t target_count() const { return targets_.size(); }
+    const std::string &target_name(uint32_t t) const { return targets_[t]; }
+    uint32_t target(SeriesId id) const { return target_[id]; }
+    const std::string &oid_str(SeriesId id) const { return oids_[id]; }
+    const uint32_t *arcs(SeriesId id) const { return &arcs_[arc_off_[id]]; }
+    size_t arcs_len(SeriesId id) const { return arc_off_[id + 1] - arc_off_[id]; }
+    uint32_t metric_id(SeriesId id) const { return metric_[id]; }
+    const MetricDesc &metric(SeriesId id) const { return metrics_[metric_[id]]; }
+    // Table index of a row (remaining arcs after the column), empty for scalars
+    const std::string &row_index(SeriesId id) const { return row_index_[id]; }
+
+private:
+    uint32_t metric_for(const OIDMapping &mapping, const std::string &oid, const uint32_t *arcs, size_t len,
+                        std::string &index);
+    std::vector<std::string> targets_;
+    std::map<std::string, uint32_t> target_ids_;
+    std::map<std::pair<uint32_t, std::string>, SeriesId> ids_; // configuration time and queries only
+    std::vector<MetricDesc> metrics_;
+    std::map<std::string, uint32_t> metric_ids_;
+    // Per series
+    std::vector<uint32_t> target_;
+    std::vector<std::string> oids_;
+    std::vector<uint32_t> arcs_;
+    std::vector<size_t> arc_off_{0};
+    std::vector<uint32_t> metric_;
+    std::vector<std::string> row_index_;
+};
+
+// Parses a dotted numeric OID ("1.3.6.1.2.1.1.3.0", leading dot allowed)
+bool parse_oid(const std::string &oid, std::vector<uint32_t> &arcs);
+// Scalars (ending with .0) and rows of table columns in the mapping can be polled with GET
+bool is_requestable(const std::string &oid, const OIDMapping &mapping);
+bool is_requestable(const uint32_t *arcs, size_t len, const OIDMapping &mapping);
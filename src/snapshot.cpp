@@ -0,0 +1,260 @@
+#include "snapshot.hpp"
+#include "series.hpp"
+#include "snmp.hpp"
+#include "log.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const char kMagic[8] = {'S', '2', 'O', 'S', 'N', 'A', 'P', '1'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kEndian = 0x01020304;
+
+enum SectionId { kPool, kOids, kArcs, kRules, kNodes, kLabels, kSections };
+
+struct Section {
+    uint64_t off; // from the start of the file, 8 byte aligned
+    uint64_t count; // elements
+};
+
+struct Source {
+    uint64_t size;
+    int64_t mtime_ns;
+    uint32_t path_off; // in the pool
+    uint32_t path_len;
+};
+
+// Size and mtime of a source file, zero for an empty path or a missing file
+Source stat_source(const std::string &path) {
+    Source s{0, 0, 0, 0};
+    file_stamp(path, s.size, s.mtime_ns);
+    return s;
+}
+
+bool write_all(int fd, const void *buf, size_t n) {
+    const char *p = static_cast<const char *>(buf);
+    while (n > 0) {
+        ssize_t w = ::write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += w; n -= (size_t)w;
+    }
+    return true;
+}
+
+} // namespace
+
+struct ConfigSnapshot::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;
+    Source sources[2]; // OID list, mapping file
+    Section sections[kSections];
+};
+
+bool ConfigSnapshot::compile(const std::string &path, const std::string &oids_file,
+                             const std::string &mapping_file) {
+    // Sources are stat'ed before reading, an edit racing the compile makes the snapshot stale
+    Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kVersion;
+    h.endian = kEndian;
+    h.sources[0] = stat_source(oids_file);
+    h.sources[1] = stat_source(mapping_file);
+
+    std::vector<std::string> oids = load_oids_file(oids_file);
+    if (oids.empty()) {
+        LOG_ERROR("No OIDs loaded from {}", oids_file);
+        return false;
+    }
+    OIDMapping mapping;
+    if (!mapping_file.empty()) mapping = OIDMapping(load_oids_info(mapping_file));
+
+    // The snapshot pool starts with the mapping's pool so rule offsets stay valid
+    std::string pool;
+    if (mapping.pool_len() > 0) pool.assign(mapping.pool(), mapping.pool_len());
+    auto add_string = [&pool](const std::string &s) {
+        uint32_t off = pool.size();
+        pool += s;
+        return off;
+    };
+    h.sources[0].path_off = add_string(oids_file);
+    h.sources[0].path_len = oids_file.size();
+    h.sources[1].path_off = add_string(mapping_file);
+    h.sources[1].path_len = mapping_file.size();
+
+    std::vector<OidEntry> entries;
+    std::vector<uint32_t> all_arcs;
+    std::vector<uint32_t> arcs;
+    for (const auto &oid : oids) {
+        OidEntry e{add_string(oid), (uint32_t)oid.size(), (uint32_t)all_arcs.size(), 0};
+        if (parse_oid(oid, arcs) || resolve_oid(oid, arcs)) {
+            all_arcs.insert(all_arcs.end(), arcs.begin(), arcs.end());
+            e.arc_len = arcs.size();
+        }
+        entries.push_back(e);
+    }
+
+    const OIDTrie &trie = mapping.trie();
+    struct Blob { const void *data; size_t size; size_t count; };
+    Blob blobs[kSections] = {
+        {pool.data(), pool.size(), pool.size()},
+        {entries.data(), entries.size() * sizeof(OidEntry), entries.size()},
+        {all_arcs.data(), all_arcs.size() * sizeof(uint32_t), all_arcs.size()},
+        {mapping.rules(), mapping.size() * sizeof(OIDMapping::Rule), mapping.size()},
+        {trie.nodes(), trie.node_count() * sizeof(OIDTrie::Node), trie.node_count()},
+        {trie.labels(), trie.label_count() * sizeof(uint32_t), trie.label_count()},
+    };
+    uint64_t off = (sizeof(Header) + 7) & ~7ull;
+    for (int i = 0; i < kSections; ++i) {
+        h.sections[i] = Section{off, blobs[i].count};
+        off = (off + blobs[i].size + 7) & ~7ull;
+    }
+
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Cannot create snapshot {}: {}", tmp, strerror(errno));
+        return false;
+    }
+    static const char zeros[8] = {};
+    bool ok = write_all(fd, &h, sizeof(h));
+    uint64_t pos = sizeof(h);
+    for (int i = 0; i < kSections && ok; ++i) {
+        ok = write_all(fd, zeros, h.sections[i].off - pos) && write_all(fd, blobs[i].data, blobs[i].size);
+        pos = h.sections[i].off + blobs[i].size;
+    }
+    ok = ok && fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        LOG_ERROR("Cannot write snapshot {}: {}", path, strerror(errno));
+        unlink(tmp.c_str());
+        return false;
+    }
+    LOG_INFO("Compiled {} OIDs and {} mapping rules into {}", entries.size(), mapping.size(), path);
+    return true;
+}
+
+bool ConfigSnapshot::open(const std::string &path, const std::string &oids_file,
+                          const std::string &mapping_file) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG_WARNING("Cannot open snapshot {}, using the text configuration", path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)) {
+        ::close(fd);
+        LOG_WARNING("Snapshot {} is truncated, using the text configuration", path);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        LOG_WARNING("Cannot map snapshot {}, using the text configuration", path);
+        return false;
+    }
+    std::shared_ptr<const void> owner(map, [size](const void *p) { munmap(const_cast<void *>(p), size); });
+    const Header *h = static_cast<const Header *>(map);
+    const char *base = static_cast<const char *>(map);
+
+    if (memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 || h->version != kVersion || h->endian != kEndian) {
+        LOG_WARNING("{} is not a snapshot of this version, using the text configuration", path);
+        return false;
+    }
+    static const size_t elem[kSections] = {1, sizeof(OidEntry), sizeof(uint32_t), sizeof(OIDMapping::Rule),
+                                            sizeof(OIDTrie::Node), sizeof(uint32_t)};
+    for (int i = 0; i < kSections; ++i) {
+        const Section &s = h->sections[i];
+        if (s.off % 8 != 0 || s.off > size || s.count > (size - s.off) / elem[i]) {
+            LOG_WARNING("Snapshot {} is corrupt, using the text configuration", path);
+            return false;
+        }
+    }
+    // Offsets inside the sections are used unchecked later, so they must stay in bounds
+    const Section *sec = h->sections;
+    auto in = [](uint64_t off, uint64_t len, uint64_t count) { return off + len <= count; };
+    bool valid = true;
+    const OidEntry *entries = reinterpret_cast<const OidEntry *>(base + sec[kOids].off);
+    for (uint64_t i = 0; i < sec[kOids].count && valid; ++i) {
+        const OidEntry &e = entries[i];
+        valid = in(e.str_off, e.str_len, sec[kPool].count) && in(e.arc_off, e.arc_len, sec[kArcs].count);
+    }
+    const OIDMapping::Rule *rules = reinterpret_cast<const OIDMapping::Rule *>(base + sec[kRules].off);
+    for (uint64_t i = 0; i < sec[kRules].count && valid; ++i) {
+        const OIDMapping::Rule &r = rules[i];
+        valid = in(r.name_off, r.name_len, sec[kPool].count) && in(r.unit_off, r.unit_len, sec[kPool].count) &&
+                in(r.type_off, r.type_len, sec[kPool].count);
+    }
+    const OIDTrie::Node *nodes = reinterpret_cast<const OIDTrie::Node *>(base + sec[kNodes].off);
+    for (uint64_t i = 0; i < sec[kNodes].count && valid; ++i) {
+        const OIDTrie::Node &n = nodes[i];
+        // Lookups read the first arc of every child label
+        valid = (i == 0 || n.label_len > 0) && in(n.label_off, n.label_len, sec[kLabels].count) &&
+                in(n.first_child, n.child_count, sec[kNodes].count) &&
+                (n.exact == OIDTrie::kNone || n.exact < sec[kRules].count) &&
+                (n.prefix == OIDTrie::kNone || n.prefix < sec[kRules].count);
+    }
+    if (!valid) {
+        LOG_WARNING("Snapshot {} is corrupt, using the text configuration", path);
+        return false;
+    }
+    // Stale when compiled from other files or the files changed since
+    const std::string *paths[2] = {&oids_file, &mapping_file};
+    for (int i = 0; i < 2; ++i) {
+        const Source &src = h->sources[i];
+        Source now = stat_source(*paths[i]);
+        bool same_path = (uint64_t)src.path_off + src.path_len <= h->sections[kPool].count &&
+                         std::string(base + h->sections[kPool].off + src.path_off, src.path_len) == *paths[i];
+        if (!same_path || src.size != now.size || src.mtime_ns != now.mtime_ns) {
+            LOG_WARNING("Snapshot {} is stale, using the text configuration", path);
+            return false;
+        }
+    }
+    map_ = std::move(owner);
+    hdr_ = h;
+    base_ = base;
+    LOG_INFO("Using configuration snapshot {}", path);
+    return true;
+}
+
+template <class T>
+const T *ConfigSnapshot::section(size_t idx) const {
+    return reinterpret_cast<const T *>(base_ + hdr_->sections[idx].off);
+}
+
+size_t ConfigSnapshot::oid_count() const {
+    return hdr_ ? hdr_->sections[kOids].count : 0;
+}
+
+std::string ConfigSnapshot::oid(size_t i) const {
+    const OidEntry &e = section<OidEntry>(kOids)[i];
+    return std::string(section<char>(kPool) + e.str_off, e.str_len);
+}
+
+const uint32_t *ConfigSnapshot::arcs(size_t i) const {
+    return section<uint32_t>(kArcs) + section<OidEntry>(kOids)[i].arc_off;
+}
+
+size_t ConfigSnapshot::arcs_len(size_t i) const {
+    return section<OidEntry>(kOids)[i].arc_len;
+}
+
+OIDMapping ConfigSnapshot::mapping() const {
+    if (!hdr_) return OIDMapping();
+    OIDTrie trie;
+    trie.attach(section<OIDTrie::Node>(kNodes), hdr_->sections[kNodes].count,
+                section<uint32_t>(kLabels), hdr_->sections[kLabels].count);
+    return OIDMapping(map_, section<OIDMapping::Rule>(kRules), hdr_->sections[kRules].count,
+                      section<char>(kPool), hdr_->sections[kPool].count, trie);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <cstdint>
+#include "mapping.hpp"
+
+// Compiled form of the OID list and the mapping file: one flat file of arrays
+// (string pool, OID arcs, mapping rules, trie nodes and labels) that is mapped
+// read-only and used in place. Start up does not parse text or build small heap
+// objects, and the pages are shared by every process mapping the same file.
+// The header records path, size and mtime of both sources; a snapshot whose
+// sources changed is rejected so the caller falls back to the text files
+class ConfigSnapshot {
+public:
+    // Parses the text sources and writes a snapshot to path (temporary file + rename)
+    static bool compile(const std::string &path, const std::string &oids_file,
+                        const std::string &mapping_file);
+    // Maps a snapshot, false when it is missing, invalid or stale
+    bool open(const std::string &path, const std::string &oids_file,
+              const std::string &mapping_file);
+
+    size_t oid_count() const;
+    std::string oid(size_t i) const;
+    // Empty (len 0) when the OID is not numeric
+    const uint32_t *arcs(size_t i) const;
+    size_t arcs_len(size_t i) const;
+    // Mapping working on the snapshot in place, keeps the file mapped
+    OIDMapping mapping() const;
+
+    struct Header;
+
+private:
+    struct OidEntry {
+        uint32_t str_off, str_len;
+        uint32_t arc_off, arc_len;
+    };
+    std::shared_ptr<const void> map_; // unmapped with the last user
+    const Header *hdr_ = nullptr;
+    const char *base_ = nullptr;
+
+    template <class T>
+    const T *section(size_t idx) const;
+};
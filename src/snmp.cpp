@@ -4,26 +4,106 @@
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <cstring>
-#include <iostream>
 #include <random>
 #include <sstream>
 #include "utils.hpp"
+#include "telemetry.hpp"
+#include "log.hpp"
 #include <iomanip>
 #include <vector>
+#include <mutex>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+
+namespace {
+
+std::once_flag g_init_once;
+std::once_flag g_mibs_once;
+std::atomic<bool> g_mibs_enabled{true};
+std::mutex g_mib_mutex; // the MIB tree is not thread safe
+std::shared_ptr<const MibIndex> g_mib_index;
+
+// Sets an environment variable for the duration of a scope
+class ScopedEnv {
+public:
+    ScopedEnv(const char *name, const char *value) : name_(name) {
+        const char *old = getenv(name);
+        had_ = old != nullptr;
+        if (had_) old_ = old;
+        setenv(name, value, 1);
+    }
+    ~ScopedEnv() {
+        if (had_) setenv(name_, old_.c_str(), 1);
+        else unsetenv(name_);
+    }
+
+private:
+    const char *name_;
+    bool had_;
+    std::string old_;
+};
+
+} // namespace
+
+void net_snmp_init() {
+    std::call_once(g_init_once, []() {
+        // init_snmp parses every MIB in MIBDIRS by default, which dominates
+        // startup. Load none, resolve_oid reads them when a name needs it
+        ScopedEnv mibs("MIBS", "");
+        ScopedEnv mibdirs("MIBDIRS", "");
+        // v2c only, there is no engine state worth persisting
+        netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_DISABLE_PERSISTENT_LOAD, 1);
+        netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_DISABLE_PERSISTENT_SAVE, 1);
+        init_snmp("snmp2otel");
+    });
+}
+
+void set_mib_loading(bool enabled) {
+    g_mibs_enabled = enabled;
+}
+
+void set_mib_index(std::shared_ptr<const MibIndex> index) {
+    g_mib_index = std::move(index);
+}
+
+bool resolve_oid(const std::string &name, std::vector<uint32_t> &arcs) {
+    arcs.clear();
+    if (g_mib_index && g_mib_index->resolve(name, arcs)) return true;
+    if (!g_mibs_enabled) return false;
+    net_snmp_init();
+    std::lock_guard<std::mutex> lock(g_mib_mutex);
+    std::call_once(g_mibs_once, []() {
+        auto t0 = std::chrono::steady_clock::now();
+        // Forget the empty directory list from net_snmp_init, then load the default MIBs
+        netsnmp_ds_set_string(NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_MIBDIRS, nullptr);
+        shutdown_mib();
+        init_mib();
+        LOG_INFO("Loaded MIBs for symbolic OIDs in {} ms", std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::steady_clock::now() - t0).count());
+    });
+    oid parsed[MAX_OID_LEN];
+    size_t len = MAX_OID_LEN;
+    if (!read_objid(name.c_str(), parsed, &len)) return false;
+    arcs.assign(parsed, parsed + len);
+    return arcs.size() >= 2;
+}
 
 
 SNMPClient::SNMPClient(const std::string &target, int port, const std::string &community,
-                       int timeout_ms, int retries, bool verbose)
+                       int timeout_ms, int retries)
 : target_(target), port_(port), community_(community),
-  timeout_ms_(timeout_ms), retries_(retries), verbose_(verbose) {
-    // Initialize the Net-SNMP library
-    init_net_snmp();
+  timeout_ms_(timeout_ms), retries_(retries) {
+    init_session();
   }
 
-SNMPClient::~SNMPClient() {}
+SNMPClient::~SNMPClient() {
+    free(session_.peername); // snmp_sess_open works on its own copy
+}
 
-void SNMPClient::init_net_snmp() {
-    init_snmp("snmp2otel");
+void SNMPClient::init_session() {
+    net_snmp_init();
     snmp_sess_init(&session_);
     session_.peername = strdup((target_ + ":" + std::to_string(port_)).c_str());
     session_.version = SNMP_VERSION_2c;
@@ -33,56 +113,169 @@ void SNMPClient::init_net_snmp() {
     session_.timeout = timeout_ms_ * 1000; // Should be in qs
 }
 
-std::map<std::string, SNMPResult> SNMPClient::get(const std::vector<std::string> &oids) {
-    std::map<std::string, SNMPResult> out;
-    
-    ss_ = snmp_open(&session_); 
+namespace {
+
+bool same_oid(const netsnmp_variable_list *vars, const uint32_t *arcs, size_t len) {
+    if (vars->name_length != len) return false;
+    for (size_t i = 0; i < len; i++)
+        if (vars->name[i] != arcs[i]) return false;
+    return true;
+}
+
+} // namespace
+
+bool decode_value(const netsnmp_variable_list *vars, SampleType &type, int64_t &value) {
+    switch (vars->type) {
+        case ASN_COUNTER64:
+            type = SampleType::Counter64;
+            value = (int64_t)(((uint64_t)vars->val.counter64->high << 32) | (vars->val.counter64->low & 0xffffffffu));
+            return true;
+        case ASN_INTEGER:
+            type = SampleType::Integer;
+            value = *vars->val.integer;
+            return true;
+        case ASN_GAUGE:
+        case ASN_COUNTER:
+        case ASN_TIMETICKS:
+            type = vars->type == ASN_GAUGE ? SampleType::Gauge
+                 : vars->type == ASN_COUNTER ? SampleType::Counter : SampleType::TimeTicks;
+            value = (int64_t)(uint32_t)*vars->val.integer; // unsigned 32-bit types
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool SNMPClient::get(const std::vector<SeriesId> &ids, const SeriesRegistry &reg, SampleBatch &out) {
+    ss_ = snmp_sess_open(&session_); 
     if (!ss_) {
-        if(verbose_)  snmp_perror("[ERROR] SNMP session could not be opened\n");
-        return out; // TODO: verify
+        LOG_LIMITED(Error, target_, "SNMP session to {} could not be opened", session_.peername);
+        status_ = STAT_ERROR;
+        return false;
     }
     pdu_ = snmp_pdu_create(SNMP_MSG_GET); // Creating pdu for get request
 
-    for (auto oid : oids) {
-        anOID_len_ = MAX_OID_LEN;
-        if (oid.size() >= 2 && oid.substr(oid.size() - 2) == ".0") { // Filtering all non-scalar OIDs out
-            if(!read_objid(oid.c_str(), anOID_, &anOID_len_)){
-                if(verbose_) std::cerr << "[ERROR] Failed to convert OID: " << oid << std::endl;
-                continue;
-            } 
-            if(!snmp_add_null_var(pdu_, anOID_,anOID_len_)){ // Adding oid to the PDU
-                if(verbose_) std::cerr << "[ERROR] Failed to add OID " << oid << " to the PDU.\n";
-            } 
-        } else {
-            if(verbose_) std::cerr << "[WARNING] OID: " << oid << " is not supported. Only scalar OID ending with .0 are.\n"; 
-        }
+    for (SeriesId id : ids) {
+        // OIDs were parsed and filtered when the series was interned
+        anOID_len_ = reg.arcs_len(id);
+        const uint32_t *arcs = reg.arcs(id);
+        for (size_t i = 0; i < anOID_len_; i++) anOID_[i] = arcs[i];
+        if(!snmp_add_null_var(pdu_, anOID_,anOID_len_)){ // Adding oid to the PDU
+            LOG_LIMITED(Error, reg.oid_str(id), "Failed to add OID {} to the PDU.", reg.oid_str(id));
+        } 
     }
     // Send the request out
-    status_ = snmp_synch_response(ss_, pdu_,  &response_);
-    if(verbose_) std::cout << "[INFO] SNMP request send to " << session_.peername << ".\n";
+    response_ = nullptr;
+    status_ = exchange();
+    LOG_DEBUG("SNMP request send to {}.", session_.peername);
     // Reply analysis
-    if (status_ == STAT_SUCCESS && response_->errstat == SNMP_ERR_NOERROR) { 
-
-        for (vars_ = response_->variables; vars_; vars_ = vars_->next_variable) {
-            if(vars_->type == ASN_GAUGE)
-            {
-            char name[1024]; // Extracting the name, resulted value and oid
-            snprint_objid(name, sizeof(name), vars_->name, vars_->name_length);
-            std::string oid = get_oid_to_string(vars_);
-            SNMPResult result;
-            result.name = name;
-            result.value = *vars_->val.integer;
-            out[oid] = result;
-            std::cout << oid << std::endl;
+    bool ok = status_ == STAT_SUCCESS && response_->errstat == SNMP_ERR_NOERROR;
+    size_t decoded = 0;
+    if (ok) { 
+        uint64_t ts = now_unix_nano();
+        // A GET response carries the varbinds in request order
+        size_t i = 0;
+        for (vars_ = response_->variables; vars_ && i < ids.size(); vars_ = vars_->next_variable, ++i) {
+            SeriesId id = ids[i];
+            SampleType type;
+            int64_t value;
+            if (!same_oid(vars_, reg.arcs(id), reg.arcs_len(id))) {
+                LOG_LIMITED(Warning, target_, "Unexpected OID {} in response from {}.", get_oid_to_string(vars_), target_);
+                continue;
+            }
+            if (decode_value(vars_, type, value)) {
+                out.append(id, ts, type, value);
+                ++decoded;
             } else {
-                if(verbose_) std::cerr << "[WARNING] The OID " << get_oid_to_string(vars_) << " is not of type GAUGE. Other types are not supported.\n";
+                LOG_LIMITED(Warning, reg.oid_str(id), "The OID {} is not of a numeric type. Other types are not supported.", reg.oid_str(id));
             }
         }
-
-        return out; 
     }
     else {
-        if(verbose_) std::cerr << "[ERROR] SNMP request failed.\n";
-        return out; 
+        LOG_LIMITED(Error, target_, "SNMP request to {} failed.", target_);
+    }
+    telemetry::add(telemetry::Samples, decoded);
+    if (response_) snmp_free_pdu(response_);
+    snmp_sess_close(ss_);
+    return ok;
+}
+
+int SNMPClient::exchange() {
+    telemetry::add(telemetry::SnmpRequests);
+    uint64_t start = telemetry::now_ns();
+    int status = snmp_sess_synch_response(ss_, pdu_, &response_);
+    telemetry::record(telemetry::PollRttNs, telemetry::now_ns() - start);
+    if (status == STAT_TIMEOUT) {
+        telemetry::add(telemetry::SnmpTimeouts);
+        telemetry::add(telemetry::SnmpRetries, session_.retries);
+    } else if (status != STAT_SUCCESS || response_->errstat != SNMP_ERR_NOERROR) {
+        telemetry::add(telemetry::SnmpErrors);
     }
-}
\ No newline at end of file
+    return status;
+}
+
+std::map<std::string, std::string> SNMPClient::get_strings(const std::vector<std::string> &oids) {
+    std::map<std::string, std::string> out;
+
+    ss_ = snmp_sess_open(&session_);
+    if (!ss_) {
+        LOG_LIMITED(Error, target_, "SNMP session to {} could not be opened", session_.peername);
+        status_ = STAT_ERROR;
+        return out;
+    }
+    pdu_ = snmp_pdu_create(SNMP_MSG_GET);
+    // Numeric only, read_objid would touch the MIB tree from the poller threads
+    std::vector<uint32_t> arcs;
+    for (const auto &oid : oids) {
+        bool parsed = parse_oid(oid, arcs) && arcs.size() <= MAX_OID_LEN;
+        if (parsed) {
+            anOID_len_ = arcs.size();
+            std::copy(arcs.begin(), arcs.end(), anOID_);
+        }
+        if (!parsed || !snmp_add_null_var(pdu_, anOID_, anOID_len_)) {
+            LOG_LIMITED(Error, oid, "Failed to add OID {} to the PDU.", oid);
+        }
+    }
+    response_ = nullptr;
+    status_ = exchange();
+    if (status_ == STAT_SUCCESS && response_->errstat == SNMP_ERR_NOERROR) {
+        for (vars_ = response_->variables; vars_; vars_ = vars_->next_variable) {
+            if (vars_->type == ASN_OCTET_STR) {
+                out[get_oid_to_string(vars_)] = std::string((const char *)vars_->val.string, vars_->val_len);
+            } else if (vars_->type == ASN_OBJECT_ID) {
+                std::string value;
+                for (size_t i = 0; i < vars_->val_len / sizeof(oid); i++) {
+                    if (i > 0) value += ".";
+                    value += std::to_string(vars_->val.objid[i]);
+                }
+                out[get_oid_to_string(vars_)] = value;
+            }
+        }
+    } else {
+        LOG_LIMITED(Error, target_, "SNMP request for resource attributes of {} failed.", target_);
+    }
+    if (response_) snmp_free_pdu(response_);
+    snmp_sess_close(ss_);
+    return out;
+}
+
+bool SNMPClient::probe() {
+    static const oid sys_uptime[] = {1, 3, 6, 1, 2, 1, 1, 3, 0};
+    // A down agent costs one timeout per probe, not timeout * (retries + 1)
+    session_.retries = 0;
+    ss_ = snmp_sess_open(&session_);
+    if (!ss_) {
+        session_.retries = retries_;
+        LOG_LIMITED(Error, target_, "SNMP session to {} could not be opened", session_.peername);
+        status_ = STAT_ERROR;
+        return false;
+    }
+    pdu_ = snmp_pdu_create(SNMP_MSG_GET);
+    snmp_add_null_var(pdu_, sys_uptime, sizeof(sys_uptime) / sizeof(oid));
+    response_ = nullptr;
+    status_ = exchange();
+    session_.retries = retries_;
+    if (response_) snmp_free_pdu(response_);
+    snmp_sess_close(ss_);
+    return responded();
+}
@@ -2,25 +2,47 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include <net-snmp/net-snmp-config.h>
 #include <net-snmp/net-snmp-includes.h>
+#include "series.hpp"
+#include "sample_batch.hpp"
+#include "mib_index.hpp"
 
-// Struct holding the key information from SNMP response
-struct SNMPResult {
-    std::string name;
-    std::string oid;
-    int value;
-};
+// Decodes a numeric varbind (Gauge32, Counter32/64, TimeTicks, Integer),
+// returns false for other types
+bool decode_value(const netsnmp_variable_list *vars, SampleType &type, int64_t &value);
+
+// Process wide net-snmp setup, done once however many clients are created.
+// No MIB is parsed here, numeric OIDs never need them
+void net_snmp_init();
+// With MIB loading disabled only numeric OIDs are accepted
+void set_mib_loading(bool enabled);
+// Resolves a symbolic OID such as IF-MIB::ifInOctets.1 to its arcs. The
+// MIBs are parsed on the first call, false when disabled or unknown
+bool resolve_oid(const std::string &name, std::vector<uint32_t> &arcs);
+// Index consulted by resolve_oid before the MIBs, set before any OID is resolved
+void set_mib_index(std::shared_ptr<const MibIndex> index);
 
 // Client 
 class SNMPClient {
 public:
     SNMPClient(const std::string &target, int port, const std::string &community,
-               int timeout_ms, int retries, bool verbose=false);
+               int timeout_ms, int retries);
     ~SNMPClient();
-    // Performs a GET for a list of scalar OIDs (e.g. "1.3.6.1.2.1.1.3.0")
-    // returns map oid -> SNMPResult for values successfully decoded
-    std::map<std::string, SNMPResult> get(const std::vector<std::string> &oids);
+    SNMPClient(const SNMPClient &) = delete;
+    SNMPClient &operator=(const SNMPClient &) = delete;
+    // Performs a GET for the given series (OIDs pre-parsed in the registry)
+    // and appends one sample per decoded value to out, in request order
+    bool get(const std::vector<SeriesId> &ids, const SeriesRegistry &reg, SampleBatch &out);
+    // GET for string-like values (OCTET STRING, OBJECT IDENTIFIER) such as sysName.0,
+    // used for the slowly changing resource attributes
+    std::map<std::string, std::string> get_strings(const std::vector<std::string> &oids);
+    // Single GET of sysUpTime.0 without retries, true when the agent answered
+    bool probe();
+    // Whether the agent answered the last request, even with an error status
+    bool responded() const { return status_ == STAT_SUCCESS; }
+    const std::string &target() const { return target_; }
 
 private:
     std::string target_;
@@ -28,9 +50,10 @@ private:
     std::string community_;
     int timeout_ms_;
     int retries_;
-    bool verbose_;
-    // Variables required by net-snmp
-    struct snmp_session session_, *ss_;
+    // Variables required by net-snmp. The single-session API keeps no global
+    // session list, so clients can be used from different poller threads
+    struct snmp_session session_;
+    void *ss_;
     struct snmp_pdu *pdu_;
     struct snmp_pdu *response_;
     struct variable_list *vars_;
@@ -38,6 +61,8 @@ private:
     oid anOID_[MAX_OID_LEN]; 
     size_t anOID_len_ = MAX_OID_LEN;
    
-   int status_;
-    void init_net_snmp();
+   int status_ = STAT_ERROR;
+    void init_session();
+    // Sends pdu_ and waits for response_, counted in the self-telemetry
+    int exchange();
 };
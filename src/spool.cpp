@@ -0,0 +1,249 @@
+#include "spool.hpp"
+#include "utils.hpp"
+#include "log.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+namespace {
+
+// Record layout: [u32 length][u32 checksum][u64 unix nano][payload]
+struct RecordHeader {
+    uint32_t len;
+    uint32_t sum;
+    uint64_t ts;
+};
+
+uint32_t fnv1a(const char *p, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; ++i) { h ^= (unsigned char)p[i]; h *= 16777619u; }
+    return h;
+}
+
+int data_sync(int fd) {
+#ifdef __APPLE__
+    return fsync(fd);
+#else
+    return fdatasync(fd);
+#endif
+}
+
+bool write_all(int fd, const void *buf, size_t n) {
+    const char *p = static_cast<const char *>(buf);
+    while (n > 0) {
+        ssize_t w = ::write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += w; n -= (size_t)w;
+    }
+    return true;
+}
+
+} // namespace
+
+Spool::Spool(const std::string &dir, uint64_t max_bytes, uint64_t max_age_s,
+             int sync_ms)
+: dir_(dir), max_bytes_(max_bytes), max_age_ns_(max_age_s * 1000000000ull),
+  sync_ms_(sync_ms) {}
+
+Spool::~Spool() {
+    close_write();
+}
+
+bool Spool::open() {
+    if (mkdir(dir_.c_str(), 0755) != 0 && errno != EEXIST) {
+        LOG_ERROR("Cannot create spool directory {}: {}", dir_, strerror(errno));
+        return false;
+    }
+    DIR *d = opendir(dir_.c_str());
+    if (!d) {
+        LOG_ERROR("Cannot open spool directory {}", dir_);
+        return false;
+    }
+    while (struct dirent *e = readdir(d)) {
+        unsigned long long seq;
+        char tail;
+        // segment files are named seg-<seq>.log
+        if (sscanf(e->d_name, "seg-%llu.lo%c", &seq, &tail) != 2 || tail != 'g') continue;
+        Segment seg{seq, dir_ + "/" + e->d_name, 0, 0, 0, 0};
+        if (scan_segment(seg)) segments_.push_back(seg);
+    }
+    closedir(d);
+    std::sort(segments_.begin(), segments_.end(),
+              [](const Segment &a, const Segment &b) { return a.seq < b.seq; });
+    for (const auto &seg : segments_) total_bytes_ += seg.size;
+    if (!segments_.empty())
+        LOG_INFO("Spool {} holds {} segment(s), {} bytes", dir_, segments_.size(), total_bytes_);
+    enforce_limits(now_unix_nano());
+    return true;
+}
+
+// Validates records of an existing segment and cuts off a torn tail
+bool Spool::scan_segment(Segment &seg) {
+    int fd = ::open(seg.path.c_str(), O_RDWR);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        unlink(seg.path.c_str());
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) { ::close(fd); return false; }
+    const char *base = static_cast<const char *>(map);
+    size_t off = 0;
+    while (off + sizeof(RecordHeader) <= size) {
+        RecordHeader h;
+        memcpy(&h, base + off, sizeof(h));
+        if (off + sizeof(h) + h.len > size || fnv1a(base + off + sizeof(h), h.len) != h.sum) break;
+        off += sizeof(h) + h.len;
+        seg.newest_ns = h.ts;
+        ++seg.records;
+    }
+    munmap(map, size);
+    if (off < size) {
+        LOG_WARNING("Truncating torn spool record in {}", seg.path);
+        if (ftruncate(fd, (off_t)off) != 0) off = size;
+    }
+    ::close(fd);
+    seg.size = off;
+    if (seg.records == 0) {
+        unlink(seg.path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Spool::roll_segment() {
+    close_write();
+    uint64_t seq = segments_.empty() ? 1 : segments_.back().seq + 1;
+    char name[64];
+    snprintf(name, sizeof(name), "/seg-%016llu.log", (unsigned long long)seq);
+    Segment seg{seq, dir_ + name, 0, 0, 0, 0};
+    fd_ = ::open(seg.path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd_ < 0) {
+        LOG_ERROR("Cannot create spool segment {}: {}", seg.path, strerror(errno));
+        return false;
+    }
+    segments_.push_back(seg);
+    return true;
+}
+
+void Spool::close_write() {
+    if (fd_ < 0) return;
+    if (dirty_) data_sync(fd_);
+    dirty_ = false;
+    ::close(fd_);
+    fd_ = -1;
+}
+
+bool Spool::append(const std::string &payload) {
+    uint64_t now = now_unix_nano();
+    // Segments left over from a previous run are only replayed, never extended
+    if (fd_ < 0 || segments_.back().size >= kSegmentBytes) {
+        if (!roll_segment()) return false;
+    }
+    RecordHeader h{(uint32_t)payload.size(), fnv1a(payload.data(), payload.size()), now};
+    Segment &seg = segments_.back();
+    if (!write_all(fd_, &h, sizeof(h)) || !write_all(fd_, payload.data(), payload.size())) {
+        LOG_ERROR("Spool write failed: {}", strerror(errno));
+        return false;
+    }
+    seg.size += sizeof(h) + payload.size();
+    seg.newest_ns = now;
+    ++seg.records;
+    total_bytes_ += sizeof(h) + payload.size();
+    dirty_ = true;
+
+    if (sync_ms_ <= 0 || now - last_sync_ns_ >= (uint64_t)sync_ms_ * 1000000ull) sync();
+    enforce_limits(now);
+    return true;
+}
+
+void Spool::sync() {
+    if (fd_ >= 0 && dirty_) data_sync(fd_);
+    dirty_ = false;
+    last_sync_ns_ = now_unix_nano();
+}
+
+uint64_t Spool::sync_if_due(uint64_t now) {
+    if (fd_ < 0 || !dirty_) return 0;
+    uint64_t due = last_sync_ns_ + (uint64_t)std::max(sync_ms_, 0) * 1000000ull;
+    if (now < due) return due;
+    sync();
+    return 0;
+}
+
+void Spool::drop_front() {
+    Segment &seg = segments_.front();
+    if (fd_ >= 0 && segments_.size() == 1) close_write();
+    unlink(seg.path.c_str());
+    total_bytes_ -= seg.size;
+    dropped_ += seg.records;
+    segments_.erase(segments_.begin());
+}
+
+void Spool::enforce_limits(uint64_t now) {
+    while (!segments_.empty() && max_bytes_ > 0 && total_bytes_ > max_bytes_) {
+        LOG_WARNING("Spool over {} bytes, dropping {}", max_bytes_, segments_.front().path);
+        drop_front();
+    }
+    while (!segments_.empty() && max_age_ns_ > 0 && segments_.front().newest_ns + max_age_ns_ < now) {
+        LOG_WARNING("Spool segment expired, dropping {}", segments_.front().path);
+        drop_front();
+    }
+}
+
+size_t Spool::replay(const std::function<bool(const std::string &)> &send) {
+    size_t sent = 0;
+    uint64_t now = now_unix_nano();
+    enforce_limits(now);
+    if (fd_ >= 0 && dirty_) sync();
+
+    while (!segments_.empty()) {
+        Segment &seg = segments_.front();
+        int fd = ::open(seg.path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            drop_front();
+            continue;
+        }
+        void *map = seg.size ? mmap(nullptr, seg.size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (map == MAP_FAILED) return sent;
+
+        const char *base = static_cast<const char *>(map);
+        bool failed = false;
+        while (seg.read_off + sizeof(RecordHeader) <= seg.size) {
+            RecordHeader h;
+            memcpy(&h, base + seg.read_off, sizeof(h));
+            bool expired = max_age_ns_ > 0 && h.ts + max_age_ns_ < now;
+            if (expired) {
+                ++dropped_;
+            } else if (!send(std::string(base + seg.read_off + sizeof(h), h.len))) {
+                failed = true;
+                break;
+            } else {
+                ++sent;
+            }
+            seg.read_off += sizeof(h) + h.len;
+            --seg.records;
+        }
+        munmap(map, seg.size);
+        if (failed) return sent;
+        // fully drained
+        if (fd_ >= 0 && segments_.size() == 1) close_write();
+        unlink(seg.path.c_str());
+        total_bytes_ -= seg.size;
+        segments_.erase(segments_.begin());
+    }
+    return sent;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+struct SpoolOptions {
+    std::string dir;
+    uint64_t max_bytes = 256u << 20;
+    uint64_t max_age_s = 86400;
+    int sync_ms = 1000; // durability window for batched fdatasync
+};
+
+// On-disk write-ahead spool for OTLP payloads that could not be delivered.
+// Payloads are appended to numbered segment files in a directory and replayed
+// oldest first once the endpoint recovers. Delivery is at-least-once: a crash
+// during replay re-sends the records of the segment being drained.
+class Spool {
+public:
+    Spool(const std::string &dir, uint64_t max_bytes, uint64_t max_age_s,
+          int sync_ms);
+    ~Spool();
+    // Creates the directory if needed and picks up segments left by a previous run
+    bool open();
+    // Appends one payload, fdatasync happens at most once per sync window
+    bool append(const std::string &payload);
+    // Hands spooled payloads to send() oldest first, stops at the first failure.
+    // Returns number of payloads delivered
+    size_t replay(const std::function<bool(const std::string &)> &send);
+    // Forces buffered records to disk
+    void sync();
+    // Syncs buffered records once the sync window since the last sync has passed,
+    // for callers that stop appending. Returns when the remaining ones are due
+    // (unix nano), 0 when nothing is buffered
+    uint64_t sync_if_due(uint64_t now);
+    bool empty() const { return segments_.empty(); }
+    uint64_t bytes() const { return total_bytes_; }
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    struct Segment {
+        uint64_t seq;
+        std::string path;
+        uint64_t size;
+        uint64_t read_off; // bytes already replayed
+        uint64_t newest_ns; // timestamp of last record
+        uint64_t records; // payloads not yet replayed
+    };
+    std::string dir_;
+    uint64_t max_bytes_;
+    uint64_t max_age_ns_;
+    int sync_ms_;
+    std::vector<Segment> segments_; // oldest first
+    int fd_ = -1; // open write segment (segments_.back())
+    uint64_t total_bytes_ = 0;
+    uint64_t dropped_ = 0;
+    uint64_t last_sync_ns_ = 0;
+    bool dirty_ = false;
+
+    static constexpr uint64_t kSegmentBytes = 8u << 20;
+
+    bool roll_segment();
+    void close_write();
+    void drop_front();
+    void enforce_limits(uint64_t now);
+    bool scan_segment(Segment &seg);
+};
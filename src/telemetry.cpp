@@ -0,0 +1,167 @@
+#include "telemetry.hpp"
+#include "utils.hpp"
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <unistd.h>
+#include <nlohmann/json.hpp>
+
+namespace telemetry {
+
+namespace {
+
+constexpr size_t kShards = 16; // threads beyond that share shards, still exact
+
+struct Desc {
+    const char *name;
+    const char *unit;
+};
+
+const Desc kCounterDesc[] = {
+    {"snmp2otel.poll.cycles", "{cycle}"},
+    {"snmp2otel.poll.missed_deadlines", "{cycle}"},
+    {"snmp2otel.snmp.requests", "{request}"},
+    {"snmp2otel.snmp.timeouts", "{request}"},
+    {"snmp2otel.snmp.retries", "{retry}"},
+    {"snmp2otel.snmp.errors", "{request}"},
+    {"snmp2otel.samples", "{sample}"},
+    {"snmp2otel.export.requests", "{request}"},
+    {"snmp2otel.export.failures", "{request}"},
+    {"snmp2otel.export.bytes", "By"},
+    {"snmp2otel.export.dropped", "{payload}"},
+};
+const Desc kHistogramDesc[] = {
+    {"snmp2otel.snmp.rtt", "ns"},
+    {"snmp2otel.poll.duration", "ns"},
+    {"snmp2otel.poll.pdus", "{pdu}"},
+    {"snmp2otel.export.encode_time", "ns"},
+    {"snmp2otel.export.serialize_time", "ns"},
+    {"snmp2otel.export.http_latency", "ns"},
+    {"snmp2otel.export.payload_size", "By"},
+};
+const Desc kGaugeDesc[] = {
+    {"snmp2otel.export.queue_depth", "{payload}"},
+};
+static_assert(sizeof(kCounterDesc) / sizeof(Desc) == kCounters, "one description per counter");
+static_assert(sizeof(kHistogramDesc) / sizeof(Desc) == kHistograms, "one description per histogram");
+static_assert(sizeof(kGaugeDesc) / sizeof(Desc) == kGauges, "one description per gauge");
+
+struct HistogramCells {
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+    std::atomic<uint64_t> buckets[kBuckets];
+};
+
+// Zero initialized as static storage
+struct alignas(64) Shard {
+    std::atomic<uint64_t> counters[kCounters];
+    HistogramCells hist[kHistograms];
+};
+
+Shard g_shards[kShards];
+std::atomic<unsigned> g_next_shard{0};
+std::atomic<int64_t> g_gauges[kGauges];
+const uint64_t g_start_unix_ns = now_unix_nano();
+
+Shard &shard() {
+    thread_local Shard *s = &g_shards[g_next_shard.fetch_add(1, std::memory_order_relaxed) % kShards];
+    return *s;
+}
+
+uint64_t load(const std::atomic<uint64_t> &a) {
+    return a.load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+void add(Counter c, uint64_t n) {
+    shard().counters[c].fetch_add(n, std::memory_order_relaxed);
+}
+
+void record(Histogram h, uint64_t value) {
+    HistogramCells &cells = shard().hist[h];
+    cells.count.fetch_add(1, std::memory_order_relaxed);
+    cells.sum.fetch_add(value, std::memory_order_relaxed);
+    cells.buckets[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t m = load(cells.max);
+    while (value > m && !cells.max.compare_exchange_weak(m, value, std::memory_order_relaxed)) {}
+}
+
+void set(Gauge g, int64_t value) {
+    g_gauges[g].store(value, std::memory_order_relaxed);
+}
+
+uint64_t now_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t counter(Counter c) {
+    uint64_t total = 0;
+    for (const auto &s : g_shards) total += load(s.counters[c]);
+    return total;
+}
+
+uint64_t count(Histogram h) {
+    uint64_t total = 0;
+    for (const auto &s : g_shards) total += load(s.hist[h].count);
+    return total;
+}
+
+uint64_t quantile(Histogram h, double q) {
+    uint64_t total = 0, max = 0;
+    for (const auto &s : g_shards) {
+        total += load(s.hist[h].count);
+        max = std::max(max, load(s.hist[h].max));
+    }
+    if (total == 0) return 0;
+    uint64_t rank = (uint64_t)(q * total + 0.999999);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < kBuckets; ++b) {
+        for (const auto &s : g_shards) seen += load(s.hist[h].buckets[b]);
+        if (seen >= rank) return std::min(bucket_high(b), max);
+    }
+    return max;
+}
+
+std::string render_resource_metrics() {
+    uint64_t now = now_unix_nano();
+    nlohmann::json metrics = nlohmann::json::array();
+    for (int c = 0; c < kCounters; ++c) {
+        nlohmann::json point = {{"startTimeUnixNano", g_start_unix_ns}, {"timeUnixNano", now},
+                                {"asInt", counter((Counter)c)}};
+        metrics.push_back({{"name", kCounterDesc[c].name}, {"unit", kCounterDesc[c].unit},
+                           {"sum", {{"dataPoints", nlohmann::json::array({point})}, {"aggregationTemporality", 2}, {"isMonotonic", true}}}});
+    }
+    for (int g = 0; g < kGauges; ++g) {
+        nlohmann::json point = {{"timeUnixNano", now}, {"asInt", g_gauges[g].load(std::memory_order_relaxed)}};
+        metrics.push_back({{"name", kGaugeDesc[g].name}, {"unit", kGaugeDesc[g].unit},
+                           {"gauge", {{"dataPoints", nlohmann::json::array({point})}}}});
+    }
+    for (int h = 0; h < kHistograms; ++h) {
+        uint64_t sum = 0;
+        for (const auto &s : g_shards) sum += load(s.hist[h].sum);
+        nlohmann::json quantiles = nlohmann::json::array();
+        for (double q : {0.5, 0.9, 0.99, 1.0})
+            quantiles.push_back({{"quantile", q}, {"value", (double)quantile((Histogram)h, q)}});
+        nlohmann::json point = {{"startTimeUnixNano", g_start_unix_ns}, {"timeUnixNano", now},
+                                {"count", count((Histogram)h)}, {"sum", (double)sum},
+                                {"quantileValues", quantiles}};
+        metrics.push_back({{"name", kHistogramDesc[h].name}, {"unit", kHistogramDesc[h].unit},
+                           {"summary", {{"dataPoints", nlohmann::json::array({point})}}}});
+    }
+
+    char host[256] = {};
+    gethostname(host, sizeof(host) - 1);
+    nlohmann::json attributes = nlohmann::json::array();
+    attributes.push_back({{"key", "service.name"}, {"value", {{"stringValue", "snmp2otel"}}}});
+    attributes.push_back({{"key", "host.name"}, {"value", {{"stringValue", host}}}});
+    attributes.push_back({{"key", "process.pid"}, {"value", {{"intValue", (int64_t)getpid()}}}});
+    nlohmann::json scope = {{"scope", {{"name", "snmp2otel.self"}}}, {"metrics", metrics}};
+    nlohmann::json rm = {{"resource", {{"attributes", attributes}}}, {"scopeMetrics", nlohmann::json::array({scope})}};
+    return rm.dump();
+}
+
+} // namespace telemetry
@@ -0,0 +1,90 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Self-telemetry of the daemon: counters, gauges and latency histograms
+// recorded on the hot paths and exported as their own OTLP scope.
+// Every thread writes into its own cache-line aligned shard with relaxed
+// atomics, readers sum the shards. Histograms are HDR style: log-linear
+// buckets with 8 sub-buckets per power of two (values within 12.5%)
+namespace telemetry {
+
+enum Counter {
+    PollCycles,
+    MissedDeadlines, // cycles that overran the poll interval
+    SnmpRequests,
+    SnmpTimeouts,
+    SnmpRetries,  // retransmissions spent on requests that timed out
+    SnmpErrors,   // error responses and send failures
+    Samples,      // decoded values
+    ExportRequests,
+    ExportFailures,
+    ExportBytes,
+    DroppedPayloads, // full destination queues and spool write failures
+    kCounters
+};
+
+enum Histogram {
+    PollRttNs,
+    PollCycleNs,
+    PdusPerCycle,
+    EncodeNs,    // per target datapoint blocks, as batches arrive
+    SerializeNs, // request bodies assembled from the blocks at flush
+    HttpLatencyNs,
+    PayloadBytes,
+    kHistograms
+};
+
+enum Gauge {
+    QueueDepth, // payloads waiting in destination queues
+    kGauges
+};
+
+// Bucket math of the histograms, shared with the benchmark sink
+constexpr unsigned kSubBits = 3;
+constexpr uint64_t kSub = 1ull << kSubBits;
+constexpr size_t kBuckets = (64 - kSubBits + 1) * kSub;
+
+// Values below kSub have a bucket each, then kSub buckets per power of two
+inline size_t bucket_of(uint64_t v) {
+    if (v < kSub) return (size_t)v;
+    unsigned e = 63 - __builtin_clzll(v);
+    return (size_t)(e - kSubBits + 1) * kSub + ((v >> (e - kSubBits)) & (kSub - 1));
+}
+
+// Highest value that falls into bucket b
+inline uint64_t bucket_high(size_t b) {
+    if (b < kSub) return b;
+    unsigned e = (unsigned)(b / kSub) + kSubBits - 1;
+    uint64_t low = (kSub + b % kSub) << (e - kSubBits);
+    return low + ((1ull << (e - kSubBits)) - 1);
+}
+
+void add(Counter c, uint64_t n=1);
+void record(Histogram h, uint64_t value);
+void set(Gauge g, int64_t value);
+
+// Monotonic clock for durations
+uint64_t now_ns();
+
+// Times a scope into a histogram
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram h) : h_(h), start_(now_ns()) {}
+    ~ScopedTimer() { record(h_, now_ns() - start_); }
+private:
+    Histogram h_;
+    uint64_t start_;
+};
+
+// Totals over all shards
+uint64_t counter(Counter c);
+// Value at quantile q (0..1) from the bucket boundaries, capped at the maximum seen
+uint64_t quantile(Histogram h, double q);
+uint64_t count(Histogram h);
+
+// One OTLP ResourceMetrics object (JSON) with every metric, cumulative since start
+std::string render_resource_metrics();
+
+} // namespace telemetry
@@ -0,0 +1,127 @@
+#include "catch.hpp"
+#include "../capture.hpp"
+#include <string>
+#include <vector>
+#include <tuple>
+#include <cstdlib>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+using Sample = std::tuple<std::string, std::string, uint64_t, SampleType, int64_t>;
+
+// Samples of the batch with their series spelled out, registries number them differently
+std::vector<Sample> spell(const SampleBatch &batch, const SeriesRegistry &reg) {
+    std::vector<Sample> out;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        SeriesId id = batch.series[i];
+        out.emplace_back(reg.target_name(reg.target(id)), reg.oid_str(id), batch.ts[i], batch.type[i], batch.value[i]);
+    }
+    return out;
+}
+
+// Replays every Response record of the capture
+size_t replay(CaptureReader &reader, const std::vector<SeriesId> &remap, SampleBatch &out) {
+    size_t responses = 0;
+    CaptureReader::Record rec;
+    while (reader.next(rec)) {
+        if (rec.kind != capture::Response) continue;
+        REQUIRE(capture_first(rec, remap) != kInvalidSeries);
+        capture_append(rec, remap, out);
+        ++responses;
+    }
+    return responses;
+}
+
+} // namespace
+
+TEST_CASE("Capture round-trips poll results and stops at a torn tail") {
+    char path[] = "/tmp/test_capture_XXXXXX";
+    int fd = mkstemp(path);
+    REQUIRE(fd >= 0);
+    close(fd);
+
+    OIDMapping mapping;
+    SeriesRegistry reg;
+    uint32_t r1 = reg.intern_target("router1");
+    uint32_t r2 = reg.intern_target("router2:1161");
+    SeriesId up = reg.intern(r1, "up", nullptr, 0, mapping);
+    SeriesId in1 = reg.intern(r1, "1.3.6.1.2.1.2.2.1.10.1", mapping);
+    SeriesId in2 = reg.intern(r1, "1.3.6.1.2.1.2.2.1.10.2", mapping);
+    SeriesId uptime = reg.intern(r2, "1.3.6.1.2.1.1.3.0", mapping);
+
+    // As the poller fills them: PDUs answered at different times, up stamped last
+    SampleBatch first, second;
+    first.append(in1, 1000, SampleType::Counter64, 1ll << 40);
+    first.append(in2, 1100, SampleType::Counter, 7);
+    first.append(up, 1200, SampleType::Gauge, 1);
+    first.append(uptime, 1500, SampleType::TimeTicks, 123456);
+    // Same series again, no new Define records
+    second.append(in1, 2000, SampleType::Counter64, (1ll << 40) + 5);
+    second.append(up, 2050, SampleType::Gauge, 1);
+    second.append(uptime, 2000, SampleType::TimeTicks, -1);
+    {
+        CaptureWriter writer(path);
+        REQUIRE(writer.open());
+        REQUIRE(writer.write(first, reg));
+        REQUIRE(writer.write(second, reg));
+    }
+
+    std::vector<Sample> expected = spell(first, reg);
+    for (const auto &s : spell(second, reg)) expected.push_back(s);
+
+    SECTION("complete capture") {
+        CaptureReader reader(path);
+        REQUIRE(reader.open());
+        // Series already known to the registry keep their IDs, the others are numbered after them
+        SeriesRegistry replayed;
+        uint32_t other = replayed.intern_target("other");
+        replayed.intern(other, "1.3.6.1.2.1.1.5.0", mapping);
+        std::vector<SeriesId> remap;
+        REQUIRE(capture_intern(reader, replayed, mapping, remap));
+        REQUIRE(replayed.size() == 5);
+        REQUIRE(replayed.find("router1", "up") != kInvalidSeries);
+
+        // One Response per target and batch, the samples keep their own timestamps
+        SampleBatch out;
+        REQUIRE(replay(reader, remap, out) == 4);
+        REQUIRE(spell(out, replayed) == expected);
+        // The cursor rewinds for the next loop of the benchmark
+        reader.rewind();
+        out.clear();
+        REQUIRE(replay(reader, remap, out) == 4);
+        REQUIRE(out.size() == expected.size());
+    }
+    SECTION("torn tail") {
+        struct stat st;
+        REQUIRE(stat(path, &st) == 0);
+        REQUIRE(truncate(path, st.st_size - 3) == 0);
+        CaptureReader reader(path);
+        REQUIRE(reader.open());
+        SeriesRegistry replayed;
+        std::vector<SeriesId> remap;
+        REQUIRE(capture_intern(reader, replayed, mapping, remap));
+        SampleBatch out;
+        // The last Response (router2 of the second batch) is lost
+        REQUIRE(replay(reader, remap, out) == 3);
+        expected.pop_back();
+        REQUIRE(spell(out, replayed) == expected);
+        CaptureReader::Record rec;
+        REQUIRE(!reader.next(rec));
+    }
+    unlink(path);
+}
+
+TEST_CASE("Capture reader rejects other files") {
+    char path[] = "/tmp/test_capture_XXXXXX";
+    int fd = mkstemp(path);
+    REQUIRE(fd >= 0);
+    REQUIRE(write(fd, "not a capture file", 18) == 18);
+    close(fd);
+    CaptureReader reader(path);
+    REQUIRE(!reader.open());
+    CaptureReader::Record rec;
+    REQUIRE(!reader.next(rec));
+    unlink(path);
+}
@@ -0,0 +1,108 @@
+#include "catch.hpp"
+#include "../otel.hpp"
+#include "../prometheus.hpp"
+#include "../config.hpp"
+#include <httplib.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// One configuration version naming the ifInOctets column metric_name of the given type
+std::shared_ptr<Config> make_config(uint64_t version, const std::string &metric_name, const std::string &type) {
+    auto cfg = std::make_shared<Config>();
+    cfg->version = version;
+    std::map<std::string, OIDInfo> info;
+    info["1.3.6.1.2.1.2.2.1.10.*"] = OIDInfo{metric_name, "By", type, false};
+    cfg->mapping = OIDMapping(info);
+    uint32_t t = cfg->registry.intern_target("router1");
+    cfg->series.resize(1);
+    for (const char *oid : {"1.3.6.1.2.1.2.2.1.10.1", "1.3.6.1.2.1.2.2.1.10.2"})
+        cfg->series[t].push_back(cfg->registry.intern(t, oid, cfg->mapping));
+    return cfg;
+}
+
+void fill(SampleBatch &batch, const std::shared_ptr<Config> &cfg, int64_t value) {
+    batch.clear();
+    batch.config = cfg;
+    for (SeriesId id : cfg->series[0]) batch.append(id, 1000000000ull, SampleType::Counter, value);
+}
+
+} // namespace
+
+TEST_CASE("Batches of an old configuration do not leave stale names behind") {
+    // The same series under two versions, as after a reload renaming the metric and
+    // classifying it as a counter
+    auto v1 = make_config(1, "if.in.old", "gauge");
+    auto v2 = make_config(2, "if.in.new", "counter");
+    REQUIRE(v1->series[0] == v2->series[0]);
+    SampleBatch batch;
+
+    SECTION("OTLP templates") {
+        httplib::Server sink;
+        std::mutex mutex;
+        std::vector<std::string> bodies;
+        sink.Post("/v1/metrics", [&](const httplib::Request &req, httplib::Response &res) {
+            std::lock_guard<std::mutex> lock(mutex);
+            bodies.push_back(req.body);
+            res.set_content("{}", "application/json");
+        });
+        int port = sink.bind_to_any_port("127.0.0.1");
+        REQUIRE(port > 0);
+        std::thread listener([&]() { sink.listen_after_bind(); });
+        {
+            OTELExporter exporter({"http://127.0.0.1:" + std::to_string(port) + "/v1/metrics"});
+            auto send = [&](const std::shared_ptr<Config> &cfg, int64_t value) {
+                fill(batch, cfg, value);
+                REQUIRE(exporter.export_batch(batch, cfg->registry));
+                REQUIRE(exporter.flush());
+            };
+            send(v1, 1);
+            // The exporter drops its templates on the first batch of the new version,
+            // then a poller still on v1 delivers
+            exporter.invalidate_templates();
+            send(v2, 2);
+            send(v1, 3);
+            send(v2, 4);
+            for (int i = 0; i < 500; ++i) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (bodies.size() == 4) break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+        sink.stop();
+        listener.join();
+        REQUIRE(bodies.size() == 4);
+        const char *names[] = {"\"if.in.old\"", "\"if.in.new\"", "\"if.in.old\"", "\"if.in.new\""};
+        for (int i = 0; i < 4; ++i) {
+            REQUIRE(bodies[i].find("\"asInt\":" + std::to_string(i + 1)) != std::string::npos);
+            REQUIRE(bodies[i].find(names[i]) != std::string::npos);
+            REQUIRE(bodies[i].find(names[(i + 1) % 2]) == std::string::npos);
+            bool counter = i % 2 == 1;
+            REQUIRE((bodies[i].find("\"sum\":{\"aggregationTemporality\":2,\"isMonotonic\":true,") !=
+                     std::string::npos) == counter);
+            REQUIRE((bodies[i].find("\"gauge\":{") != std::string::npos) == !counter);
+        }
+    }
+    SECTION("Prometheus series") {
+        PrometheusServer prometheus(0);
+        fill(batch, v1, 1);
+        prometheus.update(batch, v1->registry);
+        prometheus.reset();
+        fill(batch, v2, 2);
+        prometheus.update(batch, v2->registry);
+        fill(batch, v1, 3);
+        prometheus.update(batch, v1->registry);
+        fill(batch, v2, 4);
+        prometheus.update(batch, v2->registry);
+        prometheus.publish();
+        std::string text = prometheus.snapshot();
+        REQUIRE(text.find("if_in_new{target=\"router1\",index=\"1\"} 4 1000\n") != std::string::npos);
+        REQUIRE(text.find("if_in_new{target=\"router1\",index=\"2\"} 4 1000\n") != std::string::npos);
+        REQUIRE(text.find("if_in_old") == std::string::npos);
+        REQUIRE(text.find("# TYPE if_in_new counter\n") != std::string::npos);
+    }
+}
@@ -0,0 +1,39 @@
+#include "catch.hpp"
+#include "../health.hpp"
+
+TEST_CASE("Target health opens after consecutive failures and backs off") {
+    const uint64_t s = 1000000000ull;
+    TargetHealth h(3, 10 * s, 40 * s);
+    REQUIRE(h.next(0) == TargetHealth::Action::Poll);
+    h.report(false, 0);
+    h.report(true, 1 * s); // an answer resets the count
+    h.report(false, 2 * s);
+    h.report(false, 3 * s);
+    REQUIRE(!h.up());
+    REQUIRE(h.next(4 * s) == TargetHealth::Action::Poll);
+    h.report(false, 4 * s);
+    REQUIRE(h.down());
+    REQUIRE(h.next(5 * s) == TargetHealth::Action::Skip);
+    REQUIRE(h.next(14 * s) == TargetHealth::Action::Probe);
+
+    // Failed probes double the backoff up to the maximum
+    h.report(false, 14 * s);
+    REQUIRE(h.next(33 * s) == TargetHealth::Action::Skip);
+    REQUIRE(h.next(34 * s) == TargetHealth::Action::Probe);
+    h.report(false, 34 * s);
+    h.report(false, 74 * s);
+    REQUIRE(h.next(113 * s) == TargetHealth::Action::Skip);
+    REQUIRE(h.next(114 * s) == TargetHealth::Action::Probe);
+
+    h.report(true, 114 * s);
+    REQUIRE(h.up());
+    REQUIRE(!h.down());
+    REQUIRE(h.next(115 * s) == TargetHealth::Action::Poll);
+}
+
+TEST_CASE("Target health with the breaker disabled keeps polling") {
+    TargetHealth h(0, 1, 2);
+    for (int i = 0; i < 10; ++i) h.report(false, (uint64_t)i);
+    REQUIRE(!h.up());
+    REQUIRE(h.next(100) == TargetHealth::Action::Poll);
+}
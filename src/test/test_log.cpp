@@ -0,0 +1,98 @@
+#include "catch.hpp"
+#include "../log.hpp"
+#include <string>
+#include <cstdio>
+#include <algorithm>
+#include <unistd.h>
+
+namespace {
+
+// Everything written to the log since the last call
+std::string read_log(FILE *f) {
+    std::string out;
+    fflush(f);
+    rewind(f);
+    char buf[512];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+    rewind(f);
+    if (ftruncate(fileno(f), 0) != 0) out += "(truncate failed)";
+    return out;
+}
+
+} // namespace
+
+TEST_CASE("Logger formats arguments, levels and JSON") {
+    FILE *f = tmpfile();
+    REQUIRE(f);
+    logging::set_output(f);
+    logging::set_level(logging::Level::Info);
+
+    std::string endpoint = "http://collector:4318";
+    LOG_WARNING("Queue for {} full, {} of {} {{dropped}}", endpoint, 3, 2.5);
+    std::string text = read_log(f);
+    REQUIRE(text.find("[WARNING] Queue for http://collector:4318 full, 3 of 2.5 {dropped}\n") != std::string::npos);
+
+    // Disabled levels do not evaluate their arguments
+    int evaluated = 0;
+    LOG_DEBUG("{}", ++evaluated);
+    REQUIRE(evaluated == 0);
+    REQUIRE(read_log(f).empty());
+
+    logging::set_json(true);
+    LOG_ERROR("Bad \"value\" {} on {}", -7, "1.3.6.1.2.1.1.3.0");
+    text = read_log(f);
+    REQUIRE(text.find("\"level\":\"error\",\"msg\":\"Bad \\\"value\\\" -7 on 1.3.6.1.2.1.1.3.0\"}") != std::string::npos);
+    logging::set_json(false);
+    logging::set_output(nullptr);
+    logging::set_level(logging::Level::Warning);
+    fclose(f);
+}
+
+TEST_CASE("Logger rate limits keyed messages") {
+    FILE *f = tmpfile();
+    REQUIRE(f);
+    logging::set_output(f);
+    logging::set_rate_window(1000000000000ull);
+    for (int i = 0; i < 5; ++i) {
+        LOG_LIMITED(Warning, "1.3.6.1.2.1.1.1.0", "The OID {} is not numeric", "1.3.6.1.2.1.1.1.0");
+        LOG_LIMITED(Warning, "1.3.6.1.2.1.1.5.0", "The OID {} is not numeric", "1.3.6.1.2.1.1.5.0");
+    }
+    std::string text = read_log(f);
+    REQUIRE(text.find("1.1.0 is not numeric") != std::string::npos);
+    REQUIRE(text.find("1.5.0 is not numeric") != std::string::npos);
+    REQUIRE(std::count(text.begin(), text.end(), '\n') == 2);
+
+    // After the window the next one reports how many were suppressed
+    logging::set_rate_window(0);
+    LOG_LIMITED(Warning, "1.3.6.1.2.1.1.1.0", "The OID {} is not numeric", "1.3.6.1.2.1.1.1.0");
+    REQUIRE(read_log(f).find("(4 similar messages suppressed)") != std::string::npos);
+
+    // Long keys (string-indexed rows) leave room for the arguments and stay distinct
+    logging::set_rate_window(1000000000000ull);
+    std::string prefix(250, '1');
+    LOG_LIMITED(Warning, prefix + "2", "long key {}", 1);
+    LOG_LIMITED(Warning, prefix + "3", "long key {}", 2);
+    LOG_LIMITED(Warning, prefix + "3", "long key {}", 3);
+    text = read_log(f);
+    REQUIRE(text.find("long key 1\n") != std::string::npos);
+    REQUIRE(text.find("long key 2\n") != std::string::npos);
+    REQUIRE(text.find("long key 3") == std::string::npos);
+    logging::set_rate_window(60ull * 1000000000ull);
+    logging::set_output(nullptr);
+    fclose(f);
+}
+
+TEST_CASE("Logger drains thread rings in the background") {
+    FILE *f = tmpfile();
+    REQUIRE(f);
+    logging::set_output(f);
+    logging::start();
+    for (int i = 0; i < 100; ++i) LOG_WARNING("message {}", i);
+    logging::stop();
+    std::string text = read_log(f);
+    REQUIRE(std::count(text.begin(), text.end(), '\n') == 100);
+    REQUIRE(text.find("message 0\n") < text.find("message 99\n"));
+    logging::set_output(nullptr);
+    fclose(f);
+}
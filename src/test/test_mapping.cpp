@@ -0,0 +1,82 @@
+#include "catch.hpp"
+#include "../mapping.hpp"
+#include "../profiles.hpp"
+
+namespace {
+
+bool lookup(const OIDMapping &m, std::vector<uint32_t> arcs, std::string &name, std::string &index) {
+    OIDMapping::RuleView rule;
+    if (!m.find(arcs.data(), arcs.size(), index, rule)) return false;
+    name = std::string(rule.name);
+    return true;
+}
+
+} // namespace
+
+TEST_CASE("OID trie prefers exact rules, then the longest wildcard") {
+    std::map<std::string, OIDInfo> info;
+    info["1.3.6.1.2.1.2.2.1.10.*"] = OIDInfo{"if.in", "By", "counter", false};
+    info["1.3.6.1.2.1.2.2.1.10.3"] = OIDInfo{"if.in.three", "By", "counter", false};
+    info["1.3.6.1.2.1.2.2.*"] = OIDInfo{"if.table", "1", "gauge", false};
+    info["1.3.6.1.4.1.9.9.109.1.1.1.1.7"] = OIDInfo{"cpu.5min", "%", "gauge", true};
+    info["1.3.6.1.2.1.1.3.0"] = OIDInfo{"uptime", "cs", "gauge", false};
+    OIDMapping m(info);
+    std::string name, index;
+
+    REQUIRE(lookup(m, {1, 3, 6, 1, 2, 1, 2, 2, 1, 10, 3}, name, index));
+    REQUIRE(name == "if.in.three");
+    REQUIRE(index.empty());
+    REQUIRE(lookup(m, {1, 3, 6, 1, 2, 1, 2, 2, 1, 10, 7}, name, index));
+    REQUIRE(name == "if.in");
+    REQUIRE(index == "7");
+    // Deeper index arcs stay together, the shorter wildcard covers other columns
+    REQUIRE(lookup(m, {1, 3, 6, 1, 2, 1, 2, 2, 1, 10, 4, 1}, name, index));
+    REQUIRE(index == "4.1");
+    REQUIRE(lookup(m, {1, 3, 6, 1, 2, 1, 2, 2, 1, 16, 2}, name, index));
+    REQUIRE(name == "if.table");
+    REQUIRE(index == "1.16.2");
+    // "table": true is the same as a ".*" key
+    REQUIRE(lookup(m, {1, 3, 6, 1, 4, 1, 9, 9, 109, 1, 1, 1, 1, 7, 1}, name, index));
+    REQUIRE(name == "cpu.5min");
+    REQUIRE(index == "1");
+
+    // A wildcard matches rows below the column only, exact rules only their OID
+    REQUIRE(lookup(m, {1, 3, 6, 1, 2, 1, 2, 2, 1, 10}, name, index));
+    REQUIRE(name == "if.table");
+    REQUIRE(index == "1.10");
+    REQUIRE(!lookup(m, {1, 3, 6, 1, 4, 1, 9, 9, 109, 1, 1, 1, 1, 7}, name, index));
+    REQUIRE(!lookup(m, {1, 3, 6, 1, 2, 1, 1, 3}, name, index));
+    REQUIRE(!lookup(m, {1, 3, 6, 1, 2, 1, 1, 3, 0, 1}, name, index));
+    REQUIRE(lookup(m, {1, 3, 6, 1, 2, 1, 1, 3, 0}, name, index));
+    REQUIRE(name == "uptime");
+}
+
+TEST_CASE("OID mapping falls back to profile and MIB rules") {
+    std::map<std::string, OIDInfo> info;
+    info["1.3.6.1.2.1.2.2.1.10.*"] = OIDInfo{"custom.in", "By", "counter", false};
+    OIDMapping m(info);
+    std::shared_ptr<OIDMapping> profiles = profile_mapping({find_profile("if-mib")});
+    // Rules as MibIndex::mapping() builds them, below the profiles
+    const uint32_t high_speed[] = {1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 15};
+    const uint32_t sys_services[] = {1, 3, 6, 1, 2, 1, 1, 7, 0};
+    auto mib = std::make_shared<OIDMapping>(std::vector<OIDMapping::Source>{
+        {high_speed, 11, true, "snmp.ifHighSpeed", "Mbit/s", "gauge"},
+        {sys_services, 9, false, "snmp.sysServices", "", "gauge"},
+    });
+    profiles->set_fallback(mib);
+    m.set_fallback(profiles);
+    std::string name, index;
+
+    REQUIRE(lookup(m, {1, 3, 6, 1, 2, 1, 2, 2, 1, 10, 2}, name, index));
+    REQUIRE(name == "custom.in");
+    REQUIRE(lookup(m, {1, 3, 6, 1, 2, 1, 2, 2, 1, 16, 2}, name, index));
+    REQUIRE(name == "snmp.ifOutOctets");
+    REQUIRE(index == "2");
+    REQUIRE(lookup(m, {1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 15, 5}, name, index));
+    REQUIRE(name == "snmp.ifHighSpeed");
+    REQUIRE(index == "5");
+    REQUIRE(lookup(m, {1, 3, 6, 1, 2, 1, 1, 7, 0}, name, index));
+    REQUIRE(name == "snmp.sysServices");
+    REQUIRE(index.empty());
+    REQUIRE(!lookup(m, {1, 3, 6, 1, 4, 1, 99, 0}, name, index));
+}
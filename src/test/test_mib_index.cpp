@@ -0,0 +1,163 @@
+#include "catch.hpp"
+#include "../mib_index.hpp"
+#include <fstream>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Header: magic, version, endian, then {off, count} per section
+enum { kObjects = 1, kByOid = 4 };
+
+// Overwrites one u32 field of the first element of a section
+void patch(const std::string &path, int section, size_t field, uint32_t value) {
+    int fd = open(path.c_str(), O_RDWR);
+    REQUIRE(fd >= 0);
+    uint64_t off = 0;
+    REQUIRE(pread(fd, &off, sizeof(off), 16 + section * 16) == sizeof(off));
+    REQUIRE(pwrite(fd, &value, sizeof(value), (off_t)(off + field * 4)) == sizeof(value));
+    close(fd);
+}
+
+const char kSmi[] = R"(
+SMI-MINI DEFINITIONS ::= BEGIN
+-- Just enough of SNMPv2-SMI
+OBJECT-TYPE MACRO ::= BEGIN
+    TYPE NOTATION ::= "SYNTAX" Syntax
+    VALUE NOTATION ::= value(VALUE ObjectName)
+END
+org            OBJECT IDENTIFIER ::= { iso 3 }
+dod            OBJECT IDENTIFIER ::= { org 6 }
+internet       OBJECT IDENTIFIER ::= { dod 1 }
+mgmt           OBJECT IDENTIFIER ::= { internet 2 }
+mib-2          OBJECT IDENTIFIER ::= { mgmt 1 }
+END
+)";
+
+const char kIfMib[] = R"(
+IF-MINI DEFINITIONS ::= BEGIN
+IMPORTS
+    OBJECT-TYPE, Counter32, mib-2 FROM SMI-MINI
+    DisplayString                FROM SNMPv2-TC;
+
+DisplayString ::= TEXTUAL-CONVENTION
+    STATUS       current
+    DESCRIPTION  "Text"
+    SYNTAX       OCTET STRING (SIZE (0..255))
+
+interfaces   OBJECT IDENTIFIER ::= { mib-2 2 }
+ifNumber OBJECT-TYPE
+    SYNTAX      Integer32
+    MAX-ACCESS  read-only
+    STATUS      current
+    DESCRIPTION
+            "The number of network interfaces (regardless of their
+            current state) present on this system."
+    ::= { interfaces 1 }
+ifTable OBJECT-TYPE
+    SYNTAX      SEQUENCE OF IfEntry
+    MAX-ACCESS  not-accessible
+    STATUS      current
+    DESCRIPTION "A list of interface entries."
+    ::= { interfaces 2 }
+ifEntry OBJECT-TYPE
+    SYNTAX      IfEntry
+    MAX-ACCESS  not-accessible
+    STATUS      current
+    DESCRIPTION "An interface entry."
+    INDEX   { ifIndex }
+    ::= { ifTable 1 }
+IfEntry ::= SEQUENCE { ifIndex Integer32, ifDescr DisplayString, ifInOctets Counter32 }
+ifInOctets OBJECT-TYPE
+    SYNTAX      Counter32 -- with a comment --
+    UNITS       "octets"
+    MAX-ACCESS  read-only
+    STATUS      current
+    DESCRIPTION "The total number of octets received, including ""framing"" characters."
+    DEFVAL      { 0 }
+    ::= { ifEntry 10 }
+ifPeakRate OBJECT-TYPE
+    SYNTAX      CounterBasedGauge64
+    MAX-ACCESS  read-only
+    STATUS      current
+    DESCRIPTION "Not a counter despite its name."
+    ::= { ifEntry 11 }
+ifDrops OBJECT-TYPE
+    SYNTAX      ZeroBasedCounter32
+    MAX-ACCESS  read-only
+    STATUS      current
+    DESCRIPTION "Counter that starts at zero."
+    ::= { ifEntry 12 }
+orphan OBJECT IDENTIFIER ::= { nowhere 1 }
+END
+)";
+
+} // namespace
+
+TEST_CASE("MIB index compiles modules and resolves names") {
+    char dir[] = "/tmp/test_mib_index_XXXXXX";
+    REQUIRE(mkdtemp(dir));
+    std::string smi = std::string(dir) + "/SMI-MINI.txt";
+    std::string if_mib = std::string(dir) + "/IF-MINI.txt";
+    std::string index_file = std::string(dir) + "/mibs.idx";
+    std::ofstream(smi) << kSmi;
+    std::ofstream(if_mib) << kIfMib;
+    REQUIRE(MibIndex::compile(index_file, {dir}));
+
+    MibIndex index;
+    REQUIRE(index.open(index_file));
+    std::vector<uint32_t> arcs;
+    REQUIRE(index.resolve("IF-MINI::ifInOctets.7", arcs));
+    REQUIRE(arcs == std::vector<uint32_t>{1, 3, 6, 1, 2, 1, 2, 2, 1, 10, 7});
+    REQUIRE(index.resolve("ifNumber.0", arcs));
+    REQUIRE(arcs == std::vector<uint32_t>{1, 3, 6, 1, 2, 1, 2, 1, 0});
+    REQUIRE(!index.resolve("OTHER-MIB::ifNumber.0", arcs));
+    REQUIRE(!index.resolve("ifNumber.x", arcs));
+    REQUIRE(!index.resolve("orphan", arcs));
+
+    MibIndex::Object o;
+    REQUIRE(index.find(arcs.data(), arcs.size(), o));
+    REQUIRE(o.name == "ifNumber");
+    REQUIRE(o.syntax == "Integer32");
+    REQUIRE(o.description == "The number of network interfaces (regardless of their current state) present on this system.");
+
+    // Object types name the OIDs the mapping file lacks
+    std::vector<uint32_t> in_octets, peak, drops;
+    REQUIRE(index.resolve("ifInOctets.3", in_octets));
+    REQUIRE(index.resolve("ifPeakRate.3", peak));
+    REQUIRE(index.resolve("ifDrops.3", drops));
+    auto mapping = index.mapping({arcs, in_octets, peak, drops});
+    REQUIRE(mapping);
+    std::string row;
+    OIDMapping::RuleView rule;
+    REQUIRE(mapping->find(arcs.data(), arcs.size(), row, rule));
+    REQUIRE(rule.name == "snmp.ifNumber");
+    REQUIRE(rule.type == "gauge");
+    const uint32_t other_row[] = {1, 3, 6, 1, 2, 1, 2, 2, 1, 10, 12};
+    REQUIRE(mapping->find(other_row, 11, row, rule));
+    REQUIRE(rule.name == "snmp.ifInOctets");
+    REQUIRE(rule.unit == "By");
+    REQUIRE(rule.type == "counter");
+    REQUIRE(row == "12");
+    // Counters by their base type, not by a substring of it
+    REQUIRE(mapping->find(peak.data(), peak.size(), row, rule));
+    REQUIRE(rule.type == "gauge");
+    REQUIRE(mapping->find(drops.data(), drops.size(), row, rule));
+    REQUIRE(rule.type == "counter");
+
+    // Offsets past their sections are rejected
+    patch(index_file, kObjects, 5, 1u << 20); // arc_len
+    REQUIRE(!MibIndex().open(index_file));
+    REQUIRE(MibIndex::compile(index_file, {dir}));
+    patch(index_file, kObjects, 10, 1u << 30); // descr_off
+    REQUIRE(!MibIndex().open(index_file));
+    REQUIRE(MibIndex::compile(index_file, {dir}));
+    patch(index_file, kByOid, 0, 1000);
+    REQUIRE(!MibIndex().open(index_file));
+
+    unlink(smi.c_str());
+    unlink(if_mib.c_str());
+    unlink(index_file.c_str());
+    rmdir(dir);
+}
@@ -0,0 +1,34 @@
+#include "catch.hpp"
+#include "../profiles.hpp"
+
+TEST_CASE("Profiles are selected by sysObjectID and map their objects") {
+    static_assert(ProfileOid("1.3.6.1.2.1.1.3.0").len == 9, "OID literals are split at compile time");
+
+    auto names = [](const std::vector<const DeviceProfile *> &list) {
+        std::vector<std::string> out;
+        for (const DeviceProfile *p : list) out.push_back(p->name);
+        return out;
+    };
+    REQUIRE(names(profiles_for_sys_object_id("1.3.6.1.4.1.8072.3.2.10")) ==
+            std::vector<std::string>{"mib2", "if-mib", "host-resources", "ucd"});
+    REQUIRE(names(profiles_for_sys_object_id(".1.3.6.1.4.1.311.1.1.3.1.2")) ==
+            std::vector<std::string>{"mib2", "if-mib", "host-resources"});
+    // Prefixes end on an arc boundary
+    REQUIRE(names(profiles_for_sys_object_id("1.3.6.1.4.1.80721")) == std::vector<std::string>{"mib2", "if-mib"});
+    REQUIRE(find_profile("nope") == nullptr);
+
+    // Mapping file rules win, profile rules fill in the rest
+    std::map<std::string, OIDInfo> info;
+    info["1.3.6.1.2.1.1.3.0"] = OIDInfo{"custom.uptime", "ms", "gauge", false};
+    OIDMapping mapping(info);
+    mapping.set_fallback(profile_mapping({find_profile("mib2"), find_profile("if-mib")}));
+    std::string index;
+    OIDMapping::RuleView rule;
+    const uint32_t uptime[] = {1, 3, 6, 1, 2, 1, 1, 3, 0};
+    REQUIRE(mapping.find(uptime, 9, index, rule));
+    REQUIRE(rule.name == "custom.uptime");
+    const uint32_t in_octets[] = {1, 3, 6, 1, 2, 1, 2, 2, 1, 10, 7};
+    REQUIRE(mapping.find(in_octets, 11, index, rule));
+    REQUIRE(rule.name == "snmp.ifInOctets");
+    REQUIRE(index == "7");
+}
@@ -0,0 +1,65 @@
+#include "catch.hpp"
+#include "../ring.hpp"
+#include <thread>
+#include <vector>
+
+TEST_CASE("SpscRing keeps FIFO order and reports full and empty") {
+    SpscRing<int> ring(3);
+    REQUIRE(ring.capacity() == 4);
+    int v;
+    REQUIRE_FALSE(ring.pop(v));
+    for (int i = 0; i < 4; ++i) REQUIRE(ring.push(i));
+    REQUIRE_FALSE(ring.push(4));
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(ring.pop(v));
+        REQUIRE(v == i);
+    }
+    REQUIRE_FALSE(ring.pop(v));
+}
+
+TEST_CASE("SpscRing passes every item across threads in order") {
+    const int n = 200000;
+    SpscRing<int> ring(64);
+    std::thread producer([&] {
+        for (int i = 0; i < n; ++i)
+            while (!ring.push(i)) std::this_thread::yield();
+    });
+    int expected = 0;
+    bool ordered = true;
+    while (expected < n) {
+        int v;
+        if (!ring.pop(v)) { std::this_thread::yield(); continue; }
+        ordered = ordered && v == expected;
+        ++expected;
+    }
+    producer.join();
+    REQUIRE(ordered);
+}
+
+TEST_CASE("MpscRing delivers every item once, per-producer order preserved") {
+    const int producers = 4;
+    const int n = 50000;
+    MpscRing<uint64_t> ring(128);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (int i = 0; i < n; ++i)
+                while (!ring.push(((uint64_t)p << 32) | (uint64_t)i)) std::this_thread::yield();
+        });
+    }
+    std::vector<int64_t> last(producers, -1);
+    bool ordered = true;
+    for (int received = 0; received < producers * n;) {
+        uint64_t v;
+        if (!ring.pop(v)) { std::this_thread::yield(); continue; }
+        int p = (int)(v >> 32);
+        int64_t i = (int64_t)(v & 0xffffffffu);
+        ordered = ordered && i == last[p] + 1;
+        last[p] = i;
+        ++received;
+    }
+    for (auto &t : threads) t.join();
+    REQUIRE(ordered);
+    uint64_t v;
+    REQUIRE_FALSE(ring.pop(v));
+}
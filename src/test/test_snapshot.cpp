@@ -0,0 +1,89 @@
+#include "catch.hpp"
+#include "../snapshot.hpp"
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Header: magic, version, endian, two sources of 24 bytes, then {off, count} per section
+constexpr off_t kSectionsOff = 8 + 4 + 4 + 2 * 24;
+enum { kOids = 1, kRules = 3, kNodes = 4 };
+
+// Overwrites one u32 field of the first element of a section
+void patch(const std::string &path, int section, size_t field, uint32_t value) {
+    int fd = open(path.c_str(), O_RDWR);
+    REQUIRE(fd >= 0);
+    uint64_t off = 0;
+    REQUIRE(pread(fd, &off, sizeof(off), kSectionsOff + section * 16) == sizeof(off));
+    REQUIRE(pwrite(fd, &value, sizeof(value), (off_t)(off + field * 4)) == sizeof(value));
+    close(fd);
+}
+
+} // namespace
+
+TEST_CASE("Snapshot maps OIDs and rules, corrupt offsets are rejected") {
+    char dir[] = "/tmp/test_snapshot_XXXXXX";
+    REQUIRE(mkdtemp(dir));
+    std::string oids = std::string(dir) + "/oids.txt";
+    std::string mapping = std::string(dir) + "/mapping.json";
+    std::string snap = std::string(dir) + "/config.snap";
+    std::ofstream(oids) << "# sysUpTime\n1.3.6.1.2.1.1.3.0\n1.3.6.1.2.1.2.2.1.10.1\n";
+    std::ofstream(mapping) << R"({"1.3.6.1.2.1.1.3.0": {"name": "uptime", "unit": "cs"},
+                                  "1.3.6.1.2.1.2.2.1.10.*": {"name": "if.in", "unit": "By", "type": "counter"}})";
+    REQUIRE(ConfigSnapshot::compile(snap, oids, mapping));
+
+    {
+        ConfigSnapshot s;
+        REQUIRE(s.open(snap, oids, mapping));
+        REQUIRE(s.oid_count() == 2);
+        REQUIRE(s.oid(1) == "1.3.6.1.2.1.2.2.1.10.1");
+        REQUIRE(s.arcs_len(1) == 11);
+        REQUIRE(s.arcs(1)[10] == 1);
+        OIDMapping m = s.mapping();
+        std::string index;
+        OIDMapping::RuleView rule;
+        REQUIRE(m.find(s.arcs(1), s.arcs_len(1), index, rule));
+        REQUIRE(rule.name == "if.in");
+        REQUIRE(rule.type == "counter");
+        REQUIRE(index == "1");
+        REQUIRE(m.find(s.arcs(0), s.arcs_len(0), index, rule));
+        REQUIRE(rule.name == "uptime");
+        REQUIRE(index.empty());
+    }
+    // Other sources make it stale
+    ConfigSnapshot other;
+    REQUIRE(!other.open(snap, oids, ""));
+
+    SECTION("OID entry pointing past the arcs") {
+        patch(snap, kOids, 2, 1000); // arc_off
+    }
+    SECTION("OID string past the pool") {
+        patch(snap, kOids, 1, 1u << 30); // str_len
+    }
+    SECTION("rule name past the pool") {
+        patch(snap, kRules, 0, 0xfffffff0u); // name_off
+    }
+    SECTION("rule unit past the pool") {
+        patch(snap, kRules, 2, 1u << 20); // unit_off
+    }
+    SECTION("trie children past the nodes") {
+        patch(snap, kNodes, 2, 100); // first_child of the root
+    }
+    SECTION("trie label past the labels") {
+        patch(snap, kNodes, 6, 1u << 20); // label_off of the second node
+    }
+    SECTION("trie value past the rules") {
+        patch(snap, kNodes, 4, 7); // exact of the root
+    }
+    ConfigSnapshot corrupt;
+    REQUIRE(!corrupt.open(snap, oids, mapping));
+    REQUIRE(corrupt.oid_count() == 0);
+
+    unlink(snap.c_str());
+    unlink(oids.c_str());
+    unlink(mapping.c_str());
+    rmdir(dir);
+}
@@ -1,13 +1,28 @@
 #include "catch.hpp"
 #include "../snmp.hpp"
+#include <algorithm>
 
 TEST_CASE("SNMPClient filters OIDs correctly") {
-    SNMPClient client("localhost", 161, "public", 1000, 2, false);
+    OIDMapping mapping;
     std::vector<std::string> oids = {
         "1.3.6.1.4.1.1.0",
         "1.3.6.1.4.1.1.5",
         "1.3.6.1.4.1.2.0"
     };
-    auto values = client.get(oids); // real function call
-   // REQUIRE(values == {});
+    // Filtering happens once when the series are interned
+    SeriesRegistry registry;
+    uint32_t target = registry.intern_target("localhost");
+    std::vector<SeriesId> ids;
+    for (const auto &oid : oids)
+        if (is_requestable(oid, mapping)) ids.push_back(registry.intern(target, oid, mapping));
+    REQUIRE(ids.size() == 2);
+
+    SNMPClient client("localhost", 161, "public", 1000, 2);
+    SampleBatch batch;
+    bool ok = client.get(ids, registry, batch); // real function call
+    // Without an agent nothing is decoded, with one only the requested series come back
+    if (!ok) REQUIRE(batch.size() == 0);
+    REQUIRE(batch.size() <= ids.size());
+    for (size_t i = 0; i < batch.size(); ++i)
+        REQUIRE(std::find(ids.begin(), ids.end(), batch.series[i]) != ids.end());
 }
@@ -0,0 +1,137 @@
+#include "catch.hpp"
+#include "../spool.hpp"
+#include "../utils.hpp"
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+std::vector<std::string> segment_files(const std::string &dir) {
+    std::vector<std::string> files;
+    DIR *d = opendir(dir.c_str());
+    if (!d) return files;
+    while (struct dirent *e = readdir(d))
+        if (e->d_name[0] != '.') files.push_back(dir + "/" + e->d_name);
+    closedir(d);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+std::vector<std::string> drain(Spool &spool) {
+    std::vector<std::string> out;
+    spool.replay([&](const std::string &p) { out.push_back(p); return true; });
+    return out;
+}
+
+void remove_dir(const std::string &dir) {
+    for (const auto &f : segment_files(dir)) unlink(f.c_str());
+    rmdir(dir.c_str());
+}
+
+} // namespace
+
+TEST_CASE("Spool survives a restart and a torn tail") {
+    char dir[] = "/tmp/test_spool_XXXXXX";
+    REQUIRE(mkdtemp(dir));
+    {
+        Spool spool(dir, 0, 0, 0);
+        REQUIRE(spool.open());
+        REQUIRE(spool.append("first"));
+        REQUIRE(spool.append("second"));
+        REQUIRE(spool.append("third"));
+    }
+    auto files = segment_files(dir);
+    REQUIRE(files.size() == 1);
+    struct stat st;
+    REQUIRE(stat(files[0].c_str(), &st) == 0);
+    // Crash in the middle of the last record
+    REQUIRE(truncate(files[0].c_str(), st.st_size - 2) == 0);
+
+    Spool spool(dir, 0, 0, 0);
+    REQUIRE(spool.open());
+    REQUIRE(!spool.empty());
+    // New payloads go to a new segment and replay after the old ones
+    REQUIRE(spool.append("fourth"));
+    REQUIRE(segment_files(dir).size() == 2);
+
+    // A failed send stops the replay, the next one resumes at that payload
+    std::vector<std::string> sent;
+    size_t n = spool.replay([&](const std::string &p) {
+        if (p == "second" && sent.size() == 1) return false;
+        sent.push_back(p);
+        return true;
+    });
+    REQUIRE(n == 1);
+    auto rest = drain(spool);
+    REQUIRE(sent == std::vector<std::string>{"first"});
+    REQUIRE(rest == std::vector<std::string>{"second", "fourth"});
+    REQUIRE(spool.empty());
+    REQUIRE(spool.bytes() == 0);
+    REQUIRE(segment_files(dir).empty());
+    remove_dir(dir);
+}
+
+TEST_CASE("Spool syncs a dirty tail once the window passed without appends") {
+    char dir[] = "/tmp/test_spool_XXXXXX";
+    REQUIRE(mkdtemp(dir));
+    Spool spool(dir, 0, 0, 200);
+    REQUIRE(spool.open());
+    REQUIRE(spool.sync_if_due(now_unix_nano()) == 0);
+    // The first append syncs, the next one waits for the window
+    REQUIRE(spool.append("first"));
+    REQUIRE(spool.append("second"));
+    uint64_t now = now_unix_nano();
+    uint64_t due = spool.sync_if_due(now);
+    REQUIRE(due > now);
+    REQUIRE(due <= now + 200000000ull);
+    REQUIRE(spool.sync_if_due(now) == due);
+    // No more appends, the caller's wait loop syncs at the deadline
+    REQUIRE(spool.sync_if_due(due) == 0);
+    REQUIRE(spool.sync_if_due(due + 1) == 0);
+    REQUIRE(drain(spool) == std::vector<std::string>{"first", "second"});
+    remove_dir(dir);
+}
+
+TEST_CASE("Spool rotates segments and evicts the oldest") {
+    char dir[] = "/tmp/test_spool_XXXXXX";
+    REQUIRE(mkdtemp(dir));
+    // Segments roll over after 8 MiB
+    std::vector<std::string> payloads;
+    for (char c = 'a'; c < 'e'; ++c) payloads.push_back(std::string(3u << 20, c));
+
+    SECTION("rotation keeps the order") {
+        Spool spool(dir, 0, 0, 0);
+        REQUIRE(spool.open());
+        for (const auto &p : payloads) REQUIRE(spool.append(p));
+        REQUIRE(segment_files(dir).size() == 2);
+        REQUIRE(drain(spool) == payloads);
+    }
+    SECTION("size limit drops whole segments") {
+        Spool spool(dir, 10u << 20, 0, 0);
+        REQUIRE(spool.open());
+        for (const auto &p : payloads) REQUIRE(spool.append(p));
+        REQUIRE(segment_files(dir).size() == 1);
+        REQUIRE(spool.dropped() == 3);
+        REQUIRE(spool.bytes() <= (10u << 20));
+        REQUIRE(drain(spool) == std::vector<std::string>{payloads[3]});
+    }
+    SECTION("age limit applies on reopen") {
+        {
+            Spool spool(dir, 0, 0, 0);
+            REQUIRE(spool.open());
+            REQUIRE(spool.append("old"));
+        }
+        usleep(1100000);
+        Spool spool(dir, 0, 1, 0);
+        REQUIRE(spool.open());
+        REQUIRE(spool.empty());
+        REQUIRE(spool.dropped() == 1);
+        REQUIRE(segment_files(dir).empty());
+    }
+    remove_dir(dir);
+}
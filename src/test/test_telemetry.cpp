@@ -0,0 +1,23 @@
+#include "catch.hpp"
+#include "../telemetry.hpp"
+#include <thread>
+#include <vector>
+
+TEST_CASE("Telemetry histograms stay within one sub-bucket") {
+    // Values 1..100000 from four threads, spread over the shards. Only the poll
+    // loop records this histogram, exporter tests record the others
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([t]() {
+            for (uint64_t v = 1 + t; v <= 100000; v += 4) telemetry::record(telemetry::PdusPerCycle, v);
+        });
+    for (auto &t : threads) t.join();
+    REQUIRE(telemetry::count(telemetry::PdusPerCycle) == 100000);
+    for (double q : {0.5, 0.9, 0.99}) {
+        double exact = q * 100000;
+        double got = (double)telemetry::quantile(telemetry::PdusPerCycle, q);
+        REQUIRE(got >= exact);
+        REQUIRE(got <= exact * 1.125);
+    }
+    REQUIRE(telemetry::quantile(telemetry::PdusPerCycle, 1.0) == 100000);
+}
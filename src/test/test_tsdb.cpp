@@ -0,0 +1,46 @@
+#include "catch.hpp"
+#include "../tsdb.hpp"
+#include <random>
+
+TEST_CASE("TSDB returns compressed samples unchanged") {
+    TSDB db(1 << 20);
+    std::mt19937_64 rng(7);
+    std::vector<TSDB::Point> in;
+    uint64_t ts = 1700000000000ull;
+    int64_t counter = 0;
+    for (int i = 0; i < 5000; ++i) {
+        ts += 10000 + (int64_t)(rng() % 50) - 25; // jittered 10 s interval
+        if (i % 1000 == 999) ts += 3600000; // outage
+        counter += (int64_t)(rng() % 100000);
+        int64_t value = i % 7 == 0 ? (int64_t)rng() : counter; // occasional full-width value
+        in.push_back({ts, value});
+        db.append(3, ts, SampleType::Counter64, value);
+    }
+    std::vector<TSDB::Point> out;
+    db.query(3, 0, UINT64_MAX, out);
+    REQUIRE(out.size() == in.size());
+    bool same = true;
+    for (size_t i = 0; i < in.size(); ++i) same = same && out[i].ts_ms == in[i].ts_ms && out[i].value == in[i].value;
+    REQUIRE(same);
+
+    out.clear();
+    db.query(3, in[100].ts_ms, in[199].ts_ms, out);
+    REQUIRE(out.size() == 100);
+    REQUIRE(out.front().ts_ms == in[100].ts_ms);
+}
+
+TEST_CASE("TSDB evicts the oldest chunks when the budget is full") {
+    TSDB db(16 * 1024);
+    for (uint64_t i = 0; i < 100000; ++i) db.append((SeriesId)(i % 4), 1000 * i, SampleType::Gauge, (int64_t)(i * 31));
+    REQUIRE(db.evicted() > 0);
+    for (SeriesId id = 0; id < 4; ++id) {
+        std::vector<TSDB::Point> out;
+        db.query(id, 0, UINT64_MAX, out);
+        REQUIRE_FALSE(out.empty());
+        // Only a recent suffix survives, still in order and ending at the newest sample
+        REQUIRE(out.back().ts_ms == 1000 * (99996 + id));
+        bool ordered = true;
+        for (size_t i = 1; i < out.size(); ++i) ordered = ordered && out[i].ts_ms == out[i - 1].ts_ms + 4000;
+        REQUIRE(ordered);
+    }
+}
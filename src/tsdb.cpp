@@ -0,0 +1,272 @@
+#include "tsdb.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <httplib.h>
+#include <nlohmann/json.hpp>
+
+namespace {
+
+// Appends the low n bits of v, most significant first
+void put_bits(uint8_t *data, uint32_t &pos, uint64_t v, unsigned n) {
+    while (n > 0) {
+        unsigned used = pos & 7;
+        unsigned take = std::min(n, 8 - used);
+        uint8_t bits = (uint8_t)((v >> (n - take)) & ((1u << take) - 1));
+        if (used == 0) data[pos >> 3] = 0; // chunk memory is recycled, start the byte clean
+        data[pos >> 3] |= (uint8_t)(bits << (8 - used - take));
+        pos += take;
+        n -= take;
+    }
+}
+
+struct BitReader {
+    const uint8_t *data;
+    uint32_t pos = 0;
+
+    uint64_t get(unsigned n) {
+        uint64_t v = 0;
+        while (n > 0) {
+            unsigned avail = 8 - (pos & 7);
+            unsigned take = std::min(n, avail);
+            v = (v << take) | ((data[pos >> 3] >> (avail - take)) & ((1u << take) - 1));
+            pos += take;
+            n -= take;
+        }
+        return v;
+    }
+};
+
+int64_t sign_extend(uint64_t v, unsigned n) {
+    return (int64_t)(v << (64 - n)) >> (64 - n);
+}
+
+} // namespace
+
+TSDB::TSDB(size_t budget_bytes)
+: chunk_count_(std::max<size_t>(budget_bytes / sizeof(Chunk), 1)) {
+    chunks_.reset(new Chunk[chunk_count_]);
+}
+
+TSDB::~TSDB() {
+    stop();
+}
+
+uint32_t TSDB::alloc_chunk(SeriesId id) {
+    uint32_t idx = next_chunk_;
+    next_chunk_ = (next_chunk_ + 1) % chunk_count_;
+    Chunk &c = chunks_[idx];
+    if (c.series != kInvalidSeries) {
+        // Ring order is allocation order, so this is the oldest chunk of its series
+        Series &old = series_[c.series];
+        old.head = c.next;
+        if (old.tail == idx) old.tail = kNone;
+        ++evicted_;
+    }
+    c.series = id;
+    c.next = kNone;
+    c.bits = 0;
+    c.count = 0;
+    Series &s = series_[id];
+    if (s.tail != kNone) chunks_[s.tail].next = idx;
+    else s.head = idx;
+    s.tail = idx;
+    return idx;
+}
+
+void TSDB::append(const SampleBatch &batch) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t row = 0; row < batch.size(); ++row)
+        append_locked(batch.series[row], batch.ts[row] / 1000000ull, batch.type[row], batch.value[row]);
+}
+
+void TSDB::append(SeriesId id, uint64_t ts_ms, SampleType type, int64_t value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    append_locked(id, ts_ms, type, value);
+}
+
+void TSDB::append_locked(SeriesId id, uint64_t ts_ms, SampleType type, int64_t value) {
+    if (series_.size() <= id) series_.resize(id + 1);
+    Series &s = series_[id];
+    s.type = type;
+
+    if (s.tail == kNone || chunks_[s.tail].bits + kMaxSampleBits > kChunkBytes * 8) {
+        // New chunk starts with the raw timestamp and value
+        Chunk &c = chunks_[alloc_chunk(id)];
+        put_bits(c.data, c.bits, ts_ms, 64);
+        put_bits(c.data, c.bits, (uint64_t)value, 64);
+        c.first_ms = c.last_ms = ts_ms;
+        c.count = 1;
+        s.prev_ms = ts_ms;
+        s.prev_delta = 0;
+        s.prev_value = (uint64_t)value;
+        s.lead = 0xff;
+        return;
+    }
+    Chunk &c = chunks_[s.tail];
+
+    // Timestamp: delta of delta in buckets of 0, 7, 9, 12 and 64 bits
+    int64_t delta = (int64_t)(ts_ms - s.prev_ms);
+    int64_t dod = delta - s.prev_delta;
+    if (dod == 0) {
+        put_bits(c.data, c.bits, 0, 1);
+    } else if (dod >= -64 && dod <= 63) {
+        put_bits(c.data, c.bits, 0x2, 2);
+        put_bits(c.data, c.bits, (uint64_t)dod, 7);
+    } else if (dod >= -256 && dod <= 255) {
+        put_bits(c.data, c.bits, 0x6, 3);
+        put_bits(c.data, c.bits, (uint64_t)dod, 9);
+    } else if (dod >= -2048 && dod <= 2047) {
+        put_bits(c.data, c.bits, 0xe, 4);
+        put_bits(c.data, c.bits, (uint64_t)dod, 12);
+    } else {
+        put_bits(c.data, c.bits, 0xf, 4);
+        put_bits(c.data, c.bits, (uint64_t)dod, 64);
+    }
+
+    // Value: XOR with the previous one, meaningful bits reuse the previous window when they fit
+    uint64_t x = (uint64_t)value ^ s.prev_value;
+    if (x == 0) {
+        put_bits(c.data, c.bits, 0, 1);
+    } else {
+        uint8_t lead = (uint8_t)__builtin_clzll(x);
+        uint8_t trail = (uint8_t)__builtin_ctzll(x);
+        if (s.lead != 0xff && lead >= s.lead && trail >= s.trail) {
+            put_bits(c.data, c.bits, 0x2, 2);
+            put_bits(c.data, c.bits, x >> s.trail, 64 - s.lead - s.trail);
+        } else {
+            unsigned len = 64 - lead - trail;
+            put_bits(c.data, c.bits, 0x3, 2);
+            put_bits(c.data, c.bits, lead, 6);
+            put_bits(c.data, c.bits, len - 1, 6);
+            put_bits(c.data, c.bits, x >> trail, len);
+            s.lead = lead;
+            s.trail = trail;
+        }
+    }
+    c.last_ms = ts_ms;
+    ++c.count;
+    s.prev_ms = ts_ms;
+    s.prev_delta = delta;
+    s.prev_value = (uint64_t)value;
+}
+
+void TSDB::query(SeriesId id, uint64_t from_ms, uint64_t to_ms, std::vector<Point> &out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id >= series_.size()) return;
+    for (uint32_t idx = series_[id].head; idx != kNone; idx = chunks_[idx].next) {
+        const Chunk &c = chunks_[idx];
+        if (c.last_ms < from_ms || c.first_ms > to_ms) continue;
+        BitReader r{c.data};
+        uint64_t ts = r.get(64);
+        uint64_t value = r.get(64);
+        int64_t delta = 0;
+        unsigned lead = 0, trail = 0;
+        for (uint32_t i = 0; i < c.count; ++i) {
+            if (i > 0) {
+                int64_t dod;
+                if (!r.get(1)) dod = 0;
+                else if (!r.get(1)) dod = sign_extend(r.get(7), 7);
+                else if (!r.get(1)) dod = sign_extend(r.get(9), 9);
+                else if (!r.get(1)) dod = sign_extend(r.get(12), 12);
+                else dod = (int64_t)r.get(64);
+                delta += dod;
+                ts += delta;
+                if (r.get(1)) {
+                    if (r.get(1)) {
+                        lead = (unsigned)r.get(6);
+                        trail = 64 - lead - ((unsigned)r.get(6) + 1);
+                    }
+                    value ^= r.get(64 - lead - trail) << trail;
+                }
+            }
+            if (ts >= from_ms && ts <= to_ms) out.push_back(Point{ts, (int64_t)value});
+        }
+    }
+}
+
+void TSDB::set_registry(std::shared_ptr<const SeriesRegistry> reg) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    reg_ = std::move(reg);
+}
+
+bool TSDB::start(int port) {
+    server_.reset(new httplib::Server());
+    server_->Get("/series", [this](const httplib::Request &, httplib::Response &res) {
+        nlohmann::json body;
+        nlohmann::json list = nlohmann::json::array();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t used = 0;
+            for (size_t i = 0; i < chunk_count_; ++i) used += chunks_[i].series != kInvalidSeries;
+            body["chunks"] = chunk_count_;
+            body["chunks_used"] = used;
+            body["chunk_bytes"] = sizeof(Chunk);
+            body["evicted_chunks"] = evicted_;
+            size_t known = reg_ ? reg_->size() : 0;
+            for (SeriesId id = 0; id < series_.size() && id < known; ++id) {
+                const Series &s = series_[id];
+                if (s.head == kNone) continue;
+                uint64_t samples = 0;
+                for (uint32_t idx = s.head; idx != kNone; idx = chunks_[idx].next) samples += chunks_[idx].count;
+                list.push_back({{"series", id},
+                                {"target", reg_->target_name(reg_->target(id))},
+                                {"oid", reg_->oid_str(id)},
+                                {"metric", reg_->metric(id).name},
+                                {"samples", samples},
+                                {"from", chunks_[s.head].first_ms},
+                                {"to", chunks_[s.tail != kNone ? s.tail : s.head].last_ms}});
+            }
+        }
+        body["series"] = list;
+        res.set_content(body.dump(), "application/json");
+    });
+    server_->Get("/query", [this](const httplib::Request &req, httplib::Response &res) {
+        std::shared_ptr<const SeriesRegistry> reg;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            reg = reg_;
+        }
+        SeriesId id = kInvalidSeries;
+        if (req.has_param("series")) {
+            id = (SeriesId)strtoul(req.get_param_value("series").c_str(), nullptr, 10);
+        } else if (req.has_param("target") && req.has_param("oid")) {
+            id = reg ? reg->find(req.get_param_value("target"), req.get_param_value("oid")) : kInvalidSeries;
+        } else {
+            res.status = 400;
+            res.set_content("series or target and oid required\n", "text/plain");
+            return;
+        }
+        if (!reg || id >= reg->size()) {
+            res.status = 404;
+            res.set_content("unknown series\n", "text/plain");
+            return;
+        }
+        uint64_t from = req.has_param("from") ? strtoull(req.get_param_value("from").c_str(), nullptr, 10) : 0;
+        uint64_t to = req.has_param("to") ? strtoull(req.get_param_value("to").c_str(), nullptr, 10) : UINT64_MAX;
+        std::vector<Point> points;
+        query(id, from, to, points);
+        nlohmann::json list = nlohmann::json::array();
+        for (const auto &p : points) list.push_back({p.ts_ms, p.value});
+        nlohmann::json body = {{"series", id},
+                               {"target", reg->target_name(reg->target(id))},
+                               {"oid", reg->oid_str(id)},
+                               {"metric", reg->metric(id).name},
+                               {"points", list}};
+        res.set_content(body.dump(), "application/json");
+    });
+    if (!server_->bind_to_port("127.0.0.1", port)) {
+        LOG_ERROR("Cannot listen on port {} for cache queries", port);
+        return false;
+    }
+    thread_ = std::thread([this]() { server_->listen_after_bind(); });
+    LOG_INFO("Serving sample cache queries on 127.0.0.1:{}", port);
+    return true;
+}
+
+void TSDB::stop() {
+    if (!server_) return;
+    server_->stop();
+    if (thread_.joinable()) thread_.join();
+    server_.reset();
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <cstdint>
+#include "series.hpp"
+#include "sample_batch.hpp"
+
+namespace httplib { class Server; }
+
+// In-memory store of recent samples for re-sending or inspecting data after an
+// outage. Every series is a list of fixed-size chunks compressed Gorilla style
+// (delta-of-delta timestamps, XOR'ed values). All chunks are allocated up front
+// from the memory budget and reused in ring order, so once the budget is full
+// the oldest chunk of the whole store is evicted. Timestamps are kept in ms.
+//
+// Local HTTP API:
+//   GET /series                                   known series and store usage
+//   GET /query?series=id[&from=ms][&to=ms]        samples of one series
+//   GET /query?target=t&oid=o[&from=ms][&to=ms]
+class TSDB {
+public:
+    struct Point {
+        uint64_t ts_ms;
+        int64_t value;
+    };
+
+    explicit TSDB(size_t budget_bytes);
+    ~TSDB();
+    // Serves the query API on 127.0.0.1:port
+    bool start(int port);
+    void stop();
+    // Registry used to name series in query results, replaced on reload
+    void set_registry(std::shared_ptr<const SeriesRegistry> reg);
+    // Appends every sample of the batch
+    void append(const SampleBatch &batch);
+    void append(SeriesId id, uint64_t ts_ms, SampleType type, int64_t value);
+    // Samples of one series with from_ms <= ts <= to_ms, oldest first
+    void query(SeriesId id, uint64_t from_ms, uint64_t to_ms, std::vector<Point> &out) const;
+    size_t chunk_count() const { return chunk_count_; }
+    uint64_t evicted() const { return evicted_; }
+
+private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+    static constexpr size_t kChunkBytes = 256;
+    // Worst case of one encoded sample: 4+64 timestamp bits, 2+12+64 value bits
+    static constexpr uint32_t kMaxSampleBits = 146;
+
+    struct Chunk {
+        SeriesId series = kInvalidSeries; // owner, kInvalidSeries when unused
+        uint32_t next = kNone; // next (newer) chunk of the same series
+        uint32_t bits = 0; // bits written into data
+        uint32_t count = 0;
+        uint64_t first_ms = 0;
+        uint64_t last_ms = 0;
+        uint8_t data[kChunkBytes];
+    };
+    struct Series {
+        uint32_t head = kNone; // oldest chunk
+        uint32_t tail = kNone; // chunk being written
+        SampleType type = SampleType::Gauge;
+        // Encoder state of the tail chunk
+        uint64_t prev_ms = 0;
+        int64_t prev_delta = 0;
+        uint64_t prev_value = 0;
+        uint8_t lead = 0xff; // XOR window of the previous value, 0xff when none
+        uint8_t trail = 0;
+    };
+
+    std::unique_ptr<Chunk[]> chunks_;
+    size_t chunk_count_;
+    uint32_t next_chunk_ = 0; // ring position of the next chunk to hand out
+    uint64_t evicted_ = 0;
+    std::vector<Series> series_; // by SeriesId
+    std::shared_ptr<const SeriesRegistry> reg_;
+    mutable std::mutex mutex_; // poll loop appends, HTTP threads query
+
+    std::unique_ptr<httplib::Server> server_;
+    std::thread thread_;
+
+    uint32_t alloc_chunk(SeriesId id);
+    void append_locked(SeriesId id, uint64_t ts_ms, SampleType type, int64_t value);
+};
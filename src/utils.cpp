@@ -1,10 +1,13 @@
 #include "utils.hpp"
+#include "log.hpp"
 #include <fstream>
 #include <sstream>
 #include <chrono>
 #include <algorithm>
-#include <iostream>
+#include <cstring>
 #include <nlohmann/json.hpp>
+#include <zlib.h>
+#include <sys/stat.h>
 
 
 std::vector<std::string> load_oids_file(const std::string &path) {
@@ -25,11 +28,11 @@ std::vector<std::string> load_oids_file(const std::string &path) {
 }
 
 
-std::map<std::string, OIDInfo> load_oids_info(const std::string &file,bool verbose) {
+std::map<std::string, OIDInfo> load_oids_info(const std::string &file) {
     std::map<std::string, OIDInfo> mapping;
     std::ifstream map_file(file);
     if (!map_file) {
-        if (verbose) std::cerr << "[ERROR] Cannot open mapping file: " << file << "\n";
+        LOG_ERROR("Cannot open mapping file: {}", file);
         return mapping;
     }
 
@@ -37,7 +40,7 @@ std::map<std::string, OIDInfo> load_oids_info(const std::string &file,bool verbo
     try {
         map_file >> j;
     } catch (...) {
-        if (verbose) std::cerr << "[ERROR] Invalid JSON in mapping file\n";
+        LOG_ERROR("Invalid JSON in mapping file");
         return mapping;
     }
 
@@ -46,6 +49,7 @@ std::map<std::string, OIDInfo> load_oids_info(const std::string &file,bool verbo
         info.name = item.value().value("name", item.key()); 
         info.unit = item.value().value("unit", "");
         info.type = item.value().value("type", "gauge");
+        info.table = item.value().value("table", false);
         mapping[item.key()] = info;
     }
     return mapping;
@@ -70,4 +74,48 @@ std::string get_oid_to_string(netsnmp_variable_list * vars) {
         oid += std::to_string(vars->name[i]);
     }
     return oid;
+}
+
+std::vector<std::string> split_list(const std::string &s, char sep) {
+    std::vector<std::string> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, sep)) {
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+bool file_stamp(const std::string &path, uint64_t &size, int64_t &mtime_ns) {
+    size = 0;
+    mtime_ns = 0;
+    struct stat st;
+    if (path.empty() || stat(path.c_str(), &st) != 0) return false;
+    size = (uint64_t)st.st_size;
+#ifdef __APPLE__
+    mtime_ns = (int64_t)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+bool gzip_compress(const std::string &in, std::string &out) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    // 15 window bits + 16 selects the gzip wrapper
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;
+    out.resize(deflateBound(&zs, in.size()) + 18);
+    zs.next_in = (Bytef *)in.data();
+    zs.avail_in = in.size();
+    zs.next_out = (Bytef *)&out[0];
+    zs.avail_out = out.size();
+    int rc = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    if (rc != Z_STREAM_END) {
+        out.clear();
+        return false;
+    }
+    return true;
 }
\ No newline at end of file
@@ -2,17 +2,24 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <cstdint>
 #include <net-snmp/net-snmp-config.h>
 #include <net-snmp/net-snmp-includes.h>
 
 struct OIDInfo {
     std::string name;
     std::string unit;
-    std::string type; // gauge 
+    std::string type; // gauge or counter
+    bool table = false; // key is a table column (same as a "column.*" key), rows are merged into one metric
 };
 
 std::vector<std::string> load_oids_file(const std::string &path);
-std::map<std::string, OIDInfo> load_oids_info(const std::string &file, bool verbose);
+std::map<std::string, OIDInfo> load_oids_info(const std::string &file);
 uint64_t now_unix_nano();
 std::string oid_to_name(const std::string &oid, const std::map<std::string, OIDInfo> &mapping);
 std::string get_oid_to_string(netsnmp_variable_list * vars);
+// Compresses in into out using the gzip container (Content-Encoding: gzip)
+bool gzip_compress(const std::string &in, std::string &out);
+std::vector<std::string> split_list(const std::string &s, char sep);
+// Size and modification time of a file, false (and zeros) when it cannot be stat'ed
+bool file_stamp(const std::string &path, uint64_t &size, int64_t &mtime_ns);